@@ -20,21 +20,94 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* Protects ticks and skipped_ticks for timer_ticks(), which can
+   then read them without turning interrupts off. */
+static struct seqlock ticks_seqlock;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Tickless idle.
+
+   If true, then when the idle thread runs it reprograms the PIT
+   to raise a single interrupt when the timer next has work to
+   do, instead of one every tick, and the ticks that pass in the
+   meantime are accounted for all at once.  A single PIT count
+   spans at most ONESHOT_MAX_TICKS ticks, so a longer idle period
+   is covered by a chain of one-shot counts, each armed by the
+   interrupt that ends the one before.  Controlled by kernel
+   command-line option "-tickless". */
+bool timer_tickless;
+
+/* PIT cycles per timer tick. */
+#define PIT_TICK ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Most ticks that one PIT count can span. */
+#define ONESHOT_MAX_TICKS (65535 / PIT_TICK)
+
+/* Number of ticks spanned by the PIT's current one-shot count, or
+   0 if the PIT is in its normal periodic mode. */
+static int oneshot_ticks;
+
+/* Ticks of the current tickless idle period that come after the
+   PIT's current one-shot count, or 0 if the period ends with
+   it. */
+static int idle_ticks_left;
+
+/* Ticks that have passed but that the timer interrupt has not yet
+   accounted for. */
+static int64_t skipped_ticks;
+
+/* Pending timer events are kept in a hierarchical timing wheel,
+   as in [Varghese].  Level 0 has one slot for each of the next
+   WHEEL0_SIZE ticks.  Each higher level has WHEELN_SIZE slots,
+   each covering as many ticks as the whole level below it.
+   When level 0 wraps around, the next slot of level 1 is
+   "cascaded", that is, its events are redistributed into level
+   0, and so on up the levels.  Adding or cancelling an event
+   takes constant time, and so does each tick, apart from the
+   occasional cascade, which moves each event at most once per
+   level. */
+#define WHEEL0_BITS 8
+#define WHEELN_BITS 6
+#define WHEEL0_SIZE (1 << WHEEL0_BITS)
+#define WHEELN_SIZE (1 << WHEELN_BITS)
+#define WHEEL0_MASK (WHEEL0_SIZE - 1)
+#define WHEELN_MASK (WHEELN_SIZE - 1)
+#define WHEELN_CNT 4            /* Number of levels above level 0. */
+
+static struct list wheel0[WHEEL0_SIZE];
+static struct list wheeln[WHEELN_CNT][WHEELN_SIZE];
+
+/* Next tick whose events have not yet been run. */
+static int64_t wheel_clock;
+
 static intr_handler_func timer_interrupt;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
+static void wheel_insert (struct timer_event *);
+static void wheel_run (void);
+static int wheel_idle_ticks (int max);
+static void oneshot_arm (unsigned first, int ticks);
+static void mlfqs_tick (bool idle);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
 void
 timer_init (void) 
 {
+  int i, j;
+
+  seqlock_init (&ticks_seqlock);
+  for (i = 0; i < WHEEL0_SIZE; i++)
+    list_init (&wheel0[i]);
+  for (i = 0; i < WHEELN_CNT; i++)
+    for (j = 0; j < WHEELN_SIZE; j++)
+      list_init (&wheeln[i][j]);
+
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
@@ -70,9 +143,15 @@ timer_calibrate (void)
 int64_t
 timer_ticks (void) 
 {
-  enum intr_level old_level = intr_disable ();
-  int64_t t = ticks;
-  intr_set_level (old_level);
+  unsigned seq;
+  int64_t t;
+
+  do 
+    {
+      seq = seqlock_read_begin (&ticks_seqlock);
+      t = ticks + skipped_ticks;
+    }
+  while (seqlock_read_retry (&ticks_seqlock, seq));
   return t;
 }
 
@@ -84,6 +163,19 @@ timer_elapsed (int64_t then)
   return timer_ticks () - then;
 }
 
+/* Returns the CPU's time-stamp counter, which counts processor
+   cycles since reset.  Much finer grained than timer_ticks(), so
+   it is suitable for timing short events such as a single
+   context switch, but the rate depends on the CPU (or emulator)
+   clock. */
+uint64_t
+timer_cycles (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
    be turned on. */
 void
@@ -173,15 +265,58 @@ timer_print_stats (void)
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
+  /* If this interrupt ends a one-shot count, account for the
+     idle ticks that passed without an interrupt.  Then chain the
+     next count if the idle period goes on, otherwise go back to
+     periodic interrupts. */
+  if (oneshot_ticks > 0) 
+    {
+      seqlock_write_begin (&ticks_seqlock);
+      skipped_ticks += oneshot_ticks - 1;
+      seqlock_write_end (&ticks_seqlock);
+      oneshot_ticks = 0;
+      if (idle_ticks_left > 1)
+        oneshot_arm (PIT_TICK, idle_ticks_left);
+      else 
+        {
+          idle_ticks_left = 0;
+          pit_configure_channel (0, 2, TIMER_FREQ);
+        }
+    }
+  while (skipped_ticks > 0) 
+    {
+      seqlock_write_begin (&ticks_seqlock);
+      ticks++;
+      skipped_ticks--;
+      seqlock_write_end (&ticks_seqlock);
+      thread_idle_tick ();
+      mlfqs_tick (true);
+    }
+
+  seqlock_write_begin (&ticks_seqlock);
   ticks++;
+  seqlock_write_end (&ticks_seqlock);
   thread_tick ();
+  mlfqs_tick (false);
 
-  /* For 4BSD scheduler */
+  /* For alarm clock */
+  /* Run the timer events that are due, waking sleeping threads */
+  wheel_run ();
+}
+
+/* For 4BSD scheduler */
+/* Does the 4.4BSD scheduler's work for the tick that just ended.
+   IDLE is true for a tick that passed during tickless idle, when
+   no thread was running. */
+static void
+mlfqs_tick (bool idle)
+{
   /* When 4BSD scheduler case */
   if(thread_mlfqs)
   { 
     /* Increse recent cpu value by 1 */
-    bsd_increment();
+    if (!idle)
+      bsd_increment();
     /* When every 1 second */
     if(ticks%TIMER_FREQ == 0)
     {
@@ -189,17 +324,86 @@ timer_interrupt (struct intr_frame *args UNUSED)
       bsd_load_avg();
       bsd_recalc(); 
     }
-    /* When every 1 second */
-    if(ticks%4 == 3)
+    /* When every 4 ticks */
+    if(ticks%4 == 3 && !idle)
       /* Calculate priority of current thread */
       bsd_priority(thread_current());
   }
+}
 
-  /* For alarm clock */
-  /* When ticks is greater than next_wakeup value(=time to wake up) */
-  if(ticks >= return_wakeup())
-    /* Execute thread wake up */
-    thread_awake(ticks);
+/* Called by the idle thread, with interrupts off, just before it
+   halts the CPU.  In tickless mode, if nothing will need the
+   timer interrupt for several ticks, arranges for the next
+   interrupt to come only when something does. */
+void
+timer_idle_enter (void) 
+{
+  int n;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!timer_tickless || oneshot_ticks > 0)
+    return;
+
+  n = wheel_idle_ticks (WHEEL0_SIZE);
+  if (n > 1) 
+    {
+      /* Keep the interrupt in phase with the periodic ticks: the
+         first tick ends when the current period does. */
+      unsigned left = pit_read_count (0);
+      if (left == 0 || left > PIT_TICK)
+        left = PIT_TICK;
+      oneshot_arm (left, n);
+    }
+}
+
+/* Called with interrupts off when the CPU stops being idle, that
+   is, when the scheduler switches away from the idle thread or a
+   timer event is added.  Ends any tickless idle period in
+   progress: brings timer_ticks() up to date and arranges for a
+   timer interrupt at the next tick boundary, after which the
+   timer goes back to periodic interrupts. */
+void
+timer_idle_exit (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  idle_ticks_left = 0;
+  if (oneshot_ticks > 1 && !pit_output (0)) 
+    {
+      /* The one-shot count has not run out, so we can tell how
+         many whole ticks have passed from what is left of it.
+         The leftover part of a tick becomes a new one-shot count
+         that ends on the same tick boundary as before. */
+      unsigned left = pit_read_count (0);
+      int ahead = DIV_ROUND_UP (left, PIT_TICK);
+      unsigned rest;
+
+      if (ahead < 1)
+        ahead = 1;
+      else if (ahead > oneshot_ticks)
+        ahead = oneshot_ticks;
+      rest = left - (ahead - 1) * PIT_TICK;
+      seqlock_write_begin (&ticks_seqlock);
+      skipped_ticks += oneshot_ticks - ahead;
+      seqlock_write_end (&ticks_seqlock);
+      pit_oneshot (0, rest > 0 ? rest : 1);
+      oneshot_ticks = 1;
+    }
+}
+
+/* Starts a one-shot PIT count for the first part of a tickless
+   idle period of TICKS ticks, whose first tick ends after FIRST
+   PIT cycles.  The rest of the period is left for the interrupt
+   that ends the count to chain. */
+static void
+oneshot_arm (unsigned first, int ticks) 
+{
+  int n = ticks < ONESHOT_MAX_TICKS ? ticks : ONESHOT_MAX_TICKS;
+
+  pit_oneshot (0, first + (n - 1) * PIT_TICK);
+  oneshot_ticks = n;
+  idle_ticks_left = ticks - n;
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -272,3 +476,168 @@ real_time_delay (int64_t num, int32_t denom)
   ASSERT (denom % 1000 == 0);
   busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000)); 
 }
+
+/* Initializes EVENT to call FUNC, passing AUX, when it
+   expires. */
+void
+timer_event_init (struct timer_event *event, timer_event_func *func,
+                  void *aux) 
+{
+  ASSERT (event != NULL);
+  ASSERT (func != NULL);
+
+  event->func = func;
+  event->aux = aux;
+  event->pending = false;
+}
+
+/* Arranges for EVENT to run at tick EXPIRES, or at the next tick
+   if EXPIRES is already past.  If EVENT is already pending, it
+   is rescheduled. */
+void
+timer_event_add (struct timer_event *event, int64_t expires) 
+{
+  enum intr_level old_level = intr_disable ();
+  /* The event may be due before the end of a tickless idle
+     period that was planned without it. */
+  if (oneshot_ticks > 0)
+    timer_idle_exit ();
+  if (event->pending)
+    list_remove (&event->elem);
+  event->expires = expires;
+  event->pending = true;
+  wheel_insert (event);
+  intr_set_level (old_level);
+}
+
+/* Cancels EVENT.  Returns true if it was pending, false if it
+   had already run or had never been added. */
+bool
+timer_event_cancel (struct timer_event *event) 
+{
+  enum intr_level old_level = intr_disable ();
+  bool was_pending = event->pending;
+  if (was_pending) 
+    {
+      list_remove (&event->elem);
+      event->pending = false;
+    }
+  intr_set_level (old_level);
+  return was_pending;
+}
+
+/* Returns true if EVENT has been added and has neither run nor
+   been cancelled. */
+bool
+timer_event_pending (const struct timer_event *event) 
+{
+  return event->pending;
+}
+
+/* Puts EVENT into the timing wheel slot that covers its
+   expiration time. */
+static void
+wheel_insert (struct timer_event *event) 
+{
+  int64_t expires = event->expires;
+  int64_t delta = expires - wheel_clock;
+  struct list *slot;
+
+  if (delta < 0)
+    slot = &wheel0[wheel_clock & WHEEL0_MASK];
+  else if (delta < WHEEL0_SIZE)
+    slot = &wheel0[expires & WHEEL0_MASK];
+  else 
+    {
+      int level, shift;
+
+      /* Events too far off for the top level go in its last
+         slot and are cascaded until they are due. */
+      for (level = 0; level < WHEELN_CNT - 1; level++)
+        if (delta < (int64_t) 1 << (WHEEL0_BITS
+                                    + (level + 1) * WHEELN_BITS))
+          break;
+      if (delta >= (int64_t) 1 << (WHEEL0_BITS + WHEELN_CNT * WHEELN_BITS))
+        expires = wheel_clock
+                  + ((int64_t) 1 << (WHEEL0_BITS + WHEELN_CNT * WHEELN_BITS))
+                  - 1;
+      shift = WHEEL0_BITS + level * WHEELN_BITS;
+      slot = &wheeln[level][(expires >> shift) & WHEELN_MASK];
+    }
+  list_push_back (slot, &event->elem);
+}
+
+/* Moves the events in SLOT, which is part of a level above 0,
+   into the levels below, according to their expiration
+   times. */
+static void
+wheel_cascade (struct list *slot) 
+{
+  struct list events;
+
+  list_init (&events);
+  if (!list_empty (slot))
+    list_splice (list_end (&events), list_begin (slot), list_end (slot));
+  while (!list_empty (&events)) 
+    wheel_insert (list_entry (list_pop_front (&events),
+                              struct timer_event, elem));
+}
+
+/* Returns how many ticks from now, at most MAX, the timer
+   interrupt will next have work to do: events to run or a
+   cascade of the timing wheel. */
+static int
+wheel_idle_ticks (int max) 
+{
+  int n;
+
+  for (n = 1; n < max; n++) 
+    {
+      int idx = (wheel_clock + n - 1) & WHEEL0_MASK;
+      if (idx == 0 || !list_empty (&wheel0[idx]))
+        break;
+    }
+  return n;
+}
+
+/* Runs all the timer events that are due as of the current tick.
+   Called from the timer interrupt handler. */
+static void
+wheel_run (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (wheel_clock <= ticks) 
+    {
+      int idx = wheel_clock & WHEEL0_MASK;
+      struct list due;
+
+      /* When level 0 wraps around, refill it from the levels
+         above. */
+      if (idx == 0) 
+        {
+          int level;
+          for (level = 0; level < WHEELN_CNT; level++) 
+            {
+              int shift = WHEEL0_BITS + level * WHEELN_BITS;
+              int slot = (wheel_clock >> shift) & WHEELN_MASK;
+              wheel_cascade (&wheeln[level][slot]);
+              if (slot != 0)
+                break;
+            }
+        }
+      wheel_clock++;
+
+      list_init (&due);
+      if (!list_empty (&wheel0[idx]))
+        list_splice (list_end (&due), list_begin (&wheel0[idx]),
+                     list_end (&wheel0[idx]));
+      while (!list_empty (&due)) 
+        {
+          struct timer_event *event
+            = list_entry (list_pop_front (&due), struct timer_event, elem);
+          event->pending = false;
+          event->func (event->aux);
+        }
+    }
+}
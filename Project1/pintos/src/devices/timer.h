@@ -1,7 +1,9 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
@@ -12,6 +14,7 @@ void timer_calibrate (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
+uint64_t timer_cycles (void);
 
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep (int64_t ticks);
@@ -26,4 +29,33 @@ void timer_ndelay (int64_t nanoseconds);
 
 void timer_print_stats (void);
 
+/* Tickless idle. */
+extern bool timer_tickless;
+void timer_idle_enter (void);
+void timer_idle_exit (void);
+
+/* Timer events: deferred callbacks run by the timer interrupt.
+
+   The callback runs in the timer interrupt handler, with
+   interrupts off, at the first tick at or after the event's
+   expiration time, so it must not sleep.  The `struct
+   timer_event' belongs to its owner, who must keep it alive
+   until it has fired or been cancelled.  All of these functions
+   may be called from interrupt handlers. */
+typedef void timer_event_func (void *aux);
+
+struct timer_event
+  {
+    struct list_elem elem;      /* Element in timer wheel slot. */
+    int64_t expires;            /* Tick at which to run FUNC. */
+    timer_event_func *func;     /* Function to call. */
+    void *aux;                  /* Auxiliary data for FUNC. */
+    bool pending;               /* Added and not yet run or cancelled? */
+  };
+
+void timer_event_init (struct timer_event *, timer_event_func *, void *aux);
+void timer_event_add (struct timer_event *, int64_t expires);
+bool timer_event_cancel (struct timer_event *);
+bool timer_event_pending (const struct timer_event *);
+
 #endif /* devices/timer.h */
@@ -0,0 +1,191 @@
+#include "heap.h"
+#include "../debug.h"
+
+static struct heap_elem *meld (struct heap *,
+                               struct heap_elem *, struct heap_elem *);
+static struct heap_elem *merge_pairs (struct heap *, struct heap_elem *);
+static void cut (struct heap_elem *);
+
+/* Initializes HEAP as an empty heap ordered by LESS given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *heap, heap_less_func *less, void *aux) 
+{
+  ASSERT (heap != NULL);
+  ASSERT (less != NULL);
+
+  heap->root = NULL;
+  heap->size = 0;
+  heap->less = less;
+  heap->aux = aux;
+}
+
+/* Inserts ELEM into HEAP. */
+void
+heap_push (struct heap *heap, struct heap_elem *elem) 
+{
+  ASSERT (heap != NULL);
+  ASSERT (elem != NULL);
+
+  elem->child = elem->next = elem->prev = NULL;
+  heap->root = heap->root != NULL ? meld (heap, heap->root, elem) : elem;
+  heap->size++;
+}
+
+/* Removes and returns the greatest element in HEAP, which must
+   not be empty. */
+struct heap_elem *
+heap_pop (struct heap *heap) 
+{
+  struct heap_elem *top;
+
+  ASSERT (heap != NULL);
+  ASSERT (heap->root != NULL);
+
+  top = heap->root;
+  heap->root = merge_pairs (heap, top->child);
+  heap->size--;
+  return top;
+}
+
+/* Removes ELEM, which must be in HEAP, from HEAP. */
+void
+heap_remove (struct heap *heap, struct heap_elem *elem) 
+{
+  struct heap_elem *sub;
+
+  ASSERT (heap != NULL);
+  ASSERT (elem != NULL);
+
+  if (elem == heap->root) 
+    {
+      heap_pop (heap);
+      return;
+    }
+
+  /* Take ELEM's subtree out of the tree, replace it by its
+     children, and put that back. */
+  cut (elem);
+  sub = merge_pairs (heap, elem->child);
+  if (sub != NULL)
+    heap->root = meld (heap, heap->root, sub);
+  heap->size--;
+}
+
+/* Restores the heap order after the key of ELEM, which must be
+   in HEAP, has changed. */
+void
+heap_update (struct heap *heap, struct heap_elem *elem) 
+{
+  heap_remove (heap, elem);
+  heap_push (heap, elem);
+}
+
+/* Returns the greatest element in HEAP, or a null pointer if
+   HEAP is empty. */
+struct heap_elem *
+heap_top (const struct heap *heap) 
+{
+  ASSERT (heap != NULL);
+
+  return heap->root;
+}
+
+/* Returns the number of elements in HEAP. */
+size_t
+heap_size (const struct heap *heap) 
+{
+  ASSERT (heap != NULL);
+
+  return heap->size;
+}
+
+/* Returns true if HEAP is empty, false otherwise. */
+bool
+heap_empty (const struct heap *heap) 
+{
+  ASSERT (heap != NULL);
+
+  return heap->root == NULL;
+}
+
+/* Combines the trees rooted at A and B, which must not have
+   siblings or parents, into one, and returns its root. */
+static struct heap_elem *
+meld (struct heap *heap, struct heap_elem *a, struct heap_elem *b) 
+{
+  if (heap->less (a, b, heap->aux)) 
+    {
+      struct heap_elem *t = a;
+      a = b;
+      b = t;
+    }
+
+  /* Make B the leftmost child of A. */
+  b->prev = a;
+  b->next = a->child;
+  if (a->child != NULL)
+    a->child->prev = b;
+  a->child = b;
+  return a;
+}
+
+/* Combines the list of sibling trees starting at FIRST into one
+   tree and returns its root, or a null pointer if FIRST is null.
+   This is the standard two-pass scheme: meld the trees in pairs
+   from left to right, then meld the results together from right
+   to left. */
+static struct heap_elem *
+merge_pairs (struct heap *heap, struct heap_elem *first) 
+{
+  struct heap_elem *pairs = NULL;
+  struct heap_elem *root = NULL;
+
+  /* First pass.  PAIRS collects the melded pairs in reverse
+     order, linked through `next'. */
+  while (first != NULL) 
+    {
+      struct heap_elem *a = first;
+      struct heap_elem *b = a->next;
+      struct heap_elem *m;
+
+      if (b != NULL) 
+        {
+          first = b->next;
+          a->next = a->prev = b->next = b->prev = NULL;
+          m = meld (heap, a, b);
+        }
+      else 
+        {
+          first = NULL;
+          a->next = a->prev = NULL;
+          m = a;
+        }
+      m->next = pairs;
+      pairs = m;
+    }
+
+  /* Second pass. */
+  while (pairs != NULL) 
+    {
+      struct heap_elem *next = pairs->next;
+      pairs->next = NULL;
+      root = root != NULL ? meld (heap, pairs, root) : pairs;
+      pairs = next;
+    }
+  return root;
+}
+
+/* Detaches the subtree rooted at ELEM, which must not be the
+   root of its heap, from its parent and siblings. */
+static void
+cut (struct heap_elem *elem) 
+{
+  if (elem->prev->child == elem)
+    elem->prev->child = elem->next;
+  else
+    elem->prev->next = elem->next;
+  if (elem->next != NULL)
+    elem->next->prev = elem->prev;
+  elem->next = elem->prev = NULL;
+}
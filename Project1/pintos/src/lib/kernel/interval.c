@@ -0,0 +1,151 @@
+#include "interval.h"
+#include "../debug.h"
+
+static struct interval_elem *subtree_first (struct rb_elem *,
+                                            uintptr_t start, uintptr_t end);
+
+/* Converts red-black tree element E into the interval tree
+   element that contains it. */
+static inline struct interval_elem *
+to_interval (const struct rb_elem *e)
+{
+  return rb_entry (e, struct interval_elem, rb_elem);
+}
+
+/* Returns the greatest `end' in the subtree rooted at E, or 0 if
+   E is null. */
+static inline uintptr_t
+max_end (const struct rb_elem *e)
+{
+  return e != NULL ? to_interval (e)->max_end : 0;
+}
+
+/* Returns true if interval A starts before interval B. */
+static bool
+start_less (const struct rb_elem *a, const struct rb_elem *b,
+            void *aux UNUSED)
+{
+  return to_interval (a)->start < to_interval (b)->start;
+}
+
+/* Recomputes E's `max_end' from E and its children. */
+static void
+update_max_end (struct rb_elem *e, void *aux UNUSED)
+{
+  struct interval_elem *i = to_interval (e);
+  uintptr_t max = i->end;
+
+  if (max_end (e->left) > max)
+    max = max_end (e->left);
+  if (max_end (e->right) > max)
+    max = max_end (e->right);
+  i->max_end = max;
+}
+
+/* Initializes TREE as an empty interval tree. */
+void
+interval_init (struct interval_tree *tree)
+{
+  rb_init (&tree->tree, start_less, update_max_end, NULL);
+}
+
+/* Inserts ELEM into TREE as the interval [START, END), which
+   must not be empty. */
+void
+interval_insert (struct interval_tree *tree, struct interval_elem *elem,
+                 uintptr_t start, uintptr_t end)
+{
+  ASSERT (start < end);
+
+  elem->start = start;
+  elem->end = end;
+  elem->max_end = end;
+  rb_insert (&tree->tree, &elem->rb_elem);
+}
+
+/* Removes ELEM, which must be in TREE, from TREE. */
+void
+interval_remove (struct interval_tree *tree, struct interval_elem *elem)
+{
+  rb_remove (&tree->tree, &elem->rb_elem);
+}
+
+/* Returns the interval in TREE that overlaps [START, END) and
+   starts first, or a null pointer if none does. */
+struct interval_elem *
+interval_first (struct interval_tree *tree, uintptr_t start, uintptr_t end)
+{
+  return subtree_first (tree->tree.root, start, end);
+}
+
+/* Returns the interval after ELEM, in order of starts, that
+   overlaps [START, END), or a null pointer if there is none. */
+struct interval_elem *
+interval_next (struct interval_elem *elem, uintptr_t start, uintptr_t end)
+{
+  struct rb_elem *e = &elem->rb_elem;
+  struct interval_elem *found;
+
+  found = subtree_first (e->right, start, end);
+  if (found != NULL)
+    return found;
+
+  /* Climb until coming up from a left child.  That parent, then
+     its right subtree, are next in order. */
+  for (; e->parent != NULL; e = e->parent)
+    if (e == e->parent->left)
+      {
+        struct interval_elem *p = to_interval (e->parent);
+
+        if (p->start >= end)
+          return NULL;
+        if (p->end > start)
+          return p;
+        found = subtree_first (e->parent->right, start, end);
+        if (found != NULL)
+          return found;
+      }
+  return NULL;
+}
+
+/* Returns the number of intervals in TREE. */
+size_t
+interval_size (struct interval_tree *tree)
+{
+  return rb_size (&tree->tree);
+}
+
+/* Returns true if TREE contains no intervals, false otherwise. */
+bool
+interval_empty (struct interval_tree *tree)
+{
+  return rb_empty (&tree->tree);
+}
+
+/* Returns the interval in the subtree rooted at E that overlaps
+   [START, END) and starts first, or a null pointer if none
+   does. */
+static struct interval_elem *
+subtree_first (struct rb_elem *e, uintptr_t start, uintptr_t end)
+{
+  while (e != NULL && max_end (e) > start)
+    {
+      struct interval_elem *i = to_interval (e);
+
+      if (max_end (e->left) > start)
+        {
+          /* Some interval on the left ends after START.  Either
+             it overlaps, or it starts at or after END and so does
+             everything from E onward.  Either way, the answer is
+             on the left if anywhere. */
+          e = e->left;
+        }
+      else if (i->start >= end)
+        return NULL;
+      else if (i->end > start)
+        return i;
+      else
+        e = e->right;
+    }
+  return NULL;
+}
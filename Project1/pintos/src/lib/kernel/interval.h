@@ -0,0 +1,78 @@
+#ifndef __LIB_KERNEL_INTERVAL_H
+#define __LIB_KERNEL_INTERVAL_H
+
+/* Interval tree.
+
+   Keeps a set of half-open intervals [START, END), such as
+   ranges of virtual addresses or of disk sectors, so that the
+   intervals overlapping a given range can be found in O(log n)
+   time plus time proportional to the number found.  Intervals
+   may overlap one another.
+
+   This is a red-black tree (see lib/kernel/rbtree.h) ordered by
+   START, in which each element also records the greatest END in
+   its subtree, so that a search can skip any subtree whose
+   intervals all end before the range it is looking for.
+
+   Like struct list, the tree does not require dynamically
+   allocated memory: each structure that is a potential tree
+   element must embed a struct interval_elem member, and
+   interval_entry() converts from a struct interval_elem back to
+   the structure that contains it, just like list_entry().
+
+   Overlap search idiom:
+
+      struct interval_elem *i;
+
+      for (i = interval_first (&tree, start, end); i != NULL;
+           i = interval_next (i, start, end))
+        {
+          struct foo *f = interval_entry (i, struct foo, elem);
+          ...do something with f...
+        }
+
+   Overlapping intervals come out in order of their starts. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "rbtree.h"
+
+/* Interval tree element. */
+struct interval_elem
+  {
+    struct rb_elem rb_elem;     /* Red-black tree element. */
+    uintptr_t start;            /* First value in the interval. */
+    uintptr_t end;              /* One past the last value. */
+    uintptr_t max_end;          /* Greatest `end' in this subtree. */
+  };
+
+/* Converts pointer to interval tree element INTERVAL_ELEM into a
+   pointer to the structure that INTERVAL_ELEM is embedded inside.
+   Supply the name of the outer structure STRUCT and the member
+   name MEMBER of the interval tree element. */
+#define interval_entry(INTERVAL_ELEM, STRUCT, MEMBER)           \
+        ((STRUCT *) ((uint8_t *) &(INTERVAL_ELEM)->start        \
+                     - offsetof (STRUCT, MEMBER.start)))
+
+/* Interval tree. */
+struct interval_tree
+  {
+    struct rb_tree tree;        /* Elements ordered by `start'. */
+  };
+
+void interval_init (struct interval_tree *);
+
+void interval_insert (struct interval_tree *, struct interval_elem *,
+                      uintptr_t start, uintptr_t end);
+void interval_remove (struct interval_tree *, struct interval_elem *);
+
+struct interval_elem *interval_first (struct interval_tree *,
+                                      uintptr_t start, uintptr_t end);
+struct interval_elem *interval_next (struct interval_elem *,
+                                     uintptr_t start, uintptr_t end);
+
+size_t interval_size (struct interval_tree *);
+bool interval_empty (struct interval_tree *);
+
+#endif /* lib/kernel/interval.h */
@@ -0,0 +1,486 @@
+#include "rbtree.h"
+#include "../debug.h"
+
+/* Red-black tree.
+
+   This follows the presentation in Cormen, Leiserson, Rivest and
+   Stein, "Introduction to Algorithms", chapter 13, except that
+   missing children are null pointers rather than a shared
+   sentinel, so that the tree needs no storage of its own besides
+   struct rb_tree.  The invariants are:
+
+     1. The root is black.
+
+     2. A red element has no red children.
+
+     3. Every path from an element down to a missing child passes
+        through the same number of black elements.
+
+   Together these keep the tree's height within 2 log2 (n + 1).
+
+   In an augmented tree, the data of each element depends only
+   on the elements in its subtree.  A rotation changes the
+   subtrees of just the two elements it rotates, so it updates
+   those two, lower one first.  Adding or removing an element
+   changes the subtree of every element above it, so those are
+   updated all the way to the root. */
+
+static void rotate_left (struct rb_tree *, struct rb_elem *);
+static void rotate_right (struct rb_tree *, struct rb_elem *);
+static void insert_fixup (struct rb_tree *, struct rb_elem *);
+static void remove_fixup (struct rb_tree *, struct rb_elem *,
+                          struct rb_elem *parent);
+
+/* Returns true if E is a red element, false if it is black or
+   missing. */
+static inline bool
+is_red (const struct rb_elem *e)
+{
+  return e != NULL && e->red;
+}
+
+/* Recomputes the augmented data of E in TREE, if TREE is
+   augmented. */
+static inline void
+update (struct rb_tree *tree, struct rb_elem *e)
+{
+  if (tree->update != NULL)
+    tree->update (e, tree->aux);
+}
+
+/* Recomputes the augmented data of E and each of its ancestors
+   in TREE, if TREE is augmented. */
+static void
+update_to_root (struct rb_tree *tree, struct rb_elem *e)
+{
+  if (tree->update != NULL)
+    for (; e != NULL; e = e->parent)
+      tree->update (e, tree->aux);
+}
+
+/* Initializes TREE as an empty tree ordered by LESS, given
+   auxiliary data AUX.  If UPDATE is nonnull, the tree is
+   augmented: UPDATE is called on an element whenever its subtree
+   changes. */
+void
+rb_init (struct rb_tree *tree, rb_less_func *less, rb_update_func *update,
+         void *aux)
+{
+  ASSERT (tree != NULL);
+  ASSERT (less != NULL);
+
+  tree->root = NULL;
+  tree->size = 0;
+  tree->less = less;
+  tree->update = update;
+  tree->aux = aux;
+}
+
+/* Inserts ELEM into TREE, after any elements equal to it. */
+void
+rb_insert (struct rb_tree *tree, struct rb_elem *elem)
+{
+  struct rb_elem *parent = NULL;
+  struct rb_elem **link = &tree->root;
+
+  ASSERT (tree != NULL);
+  ASSERT (elem != NULL);
+
+  while (*link != NULL)
+    {
+      parent = *link;
+      if (tree->less (elem, parent, tree->aux))
+        link = &parent->left;
+      else
+        link = &parent->right;
+    }
+
+  elem->parent = parent;
+  elem->left = elem->right = NULL;
+  elem->red = true;
+  *link = elem;
+  tree->size++;
+
+  update_to_root (tree, elem);
+  insert_fixup (tree, elem);
+}
+
+/* Replaces the subtree rooted at OLD in TREE by the one rooted
+   at NEW, which may be null.  Does not change OLD's links. */
+static void
+transplant (struct rb_tree *tree, struct rb_elem *old, struct rb_elem *new)
+{
+  if (old->parent == NULL)
+    tree->root = new;
+  else if (old == old->parent->left)
+    old->parent->left = new;
+  else
+    old->parent->right = new;
+  if (new != NULL)
+    new->parent = old->parent;
+}
+
+/* Removes ELEM, which must be in TREE, from TREE. */
+void
+rb_remove (struct rb_tree *tree, struct rb_elem *elem)
+{
+  struct rb_elem *child;        /* Element that moved up. */
+  struct rb_elem *parent;       /* CHILD's new parent. */
+  bool removed_red;             /* Color taken out of the tree. */
+
+  ASSERT (tree != NULL);
+  ASSERT (elem != NULL);
+  ASSERT (tree->size > 0);
+
+  if (elem->left == NULL || elem->right == NULL)
+    {
+      /* ELEM has at most one child, which takes its place. */
+      child = elem->left != NULL ? elem->left : elem->right;
+      parent = elem->parent;
+      removed_red = elem->red;
+      transplant (tree, elem, child);
+    }
+  else
+    {
+      /* ELEM's successor, which has no left child, takes its
+         place and color, so the successor's old color is the one
+         removed from the tree. */
+      struct rb_elem *next = elem->right;
+      while (next->left != NULL)
+        next = next->left;
+      child = next->right;
+      removed_red = next->red;
+
+      if (next->parent == elem)
+        parent = next;
+      else
+        {
+          parent = next->parent;
+          transplant (tree, next, child);
+          next->right = elem->right;
+          next->right->parent = next;
+        }
+      transplant (tree, elem, next);
+      next->left = elem->left;
+      next->left->parent = next;
+      next->red = elem->red;
+    }
+  tree->size--;
+
+  update_to_root (tree, parent);
+  if (!removed_red)
+    remove_fixup (tree, child, parent);
+}
+
+/* Returns the first element in TREE equal to KEY, or a null
+   pointer if there is none. */
+struct rb_elem *
+rb_find (const struct rb_tree *tree, const struct rb_elem *key)
+{
+  struct rb_elem *e = rb_lower_bound (tree, key);
+
+  if (e != NULL && !tree->less (key, e, tree->aux))
+    return e;
+  return NULL;
+}
+
+/* Returns the first element in TREE that is not less than KEY,
+   or a null pointer if there is none. */
+struct rb_elem *
+rb_lower_bound (const struct rb_tree *tree, const struct rb_elem *key)
+{
+  struct rb_elem *e = tree->root;
+  struct rb_elem *bound = NULL;
+
+  while (e != NULL)
+    if (tree->less (e, key, tree->aux))
+      e = e->right;
+    else
+      {
+        bound = e;
+        e = e->left;
+      }
+  return bound;
+}
+
+/* Returns the first element in TREE that is greater than KEY, or
+   a null pointer if there is none. */
+struct rb_elem *
+rb_upper_bound (const struct rb_tree *tree, const struct rb_elem *key)
+{
+  struct rb_elem *e = tree->root;
+  struct rb_elem *bound = NULL;
+
+  while (e != NULL)
+    if (tree->less (key, e, tree->aux))
+      {
+        bound = e;
+        e = e->left;
+      }
+    else
+      e = e->right;
+  return bound;
+}
+
+/* Returns the least element in TREE, or a null pointer if TREE
+   is empty. */
+struct rb_elem *
+rb_first (const struct rb_tree *tree)
+{
+  struct rb_elem *e = tree->root;
+
+  if (e != NULL)
+    while (e->left != NULL)
+      e = e->left;
+  return e;
+}
+
+/* Returns the greatest element in TREE, or a null pointer if
+   TREE is empty. */
+struct rb_elem *
+rb_last (const struct rb_tree *tree)
+{
+  struct rb_elem *e = tree->root;
+
+  if (e != NULL)
+    while (e->right != NULL)
+      e = e->right;
+  return e;
+}
+
+/* Returns the element after E in its tree, or a null pointer if
+   E is the last element. */
+struct rb_elem *
+rb_next (const struct rb_elem *e)
+{
+  ASSERT (e != NULL);
+
+  if (e->right != NULL)
+    {
+      e = e->right;
+      while (e->left != NULL)
+        e = e->left;
+      return (struct rb_elem *) e;
+    }
+  while (e->parent != NULL && e == e->parent->right)
+    e = e->parent;
+  return e->parent;
+}
+
+/* Returns the element before E in its tree, or a null pointer if
+   E is the first element. */
+struct rb_elem *
+rb_prev (const struct rb_elem *e)
+{
+  ASSERT (e != NULL);
+
+  if (e->left != NULL)
+    {
+      e = e->left;
+      while (e->right != NULL)
+        e = e->right;
+      return (struct rb_elem *) e;
+    }
+  while (e->parent != NULL && e == e->parent->left)
+    e = e->parent;
+  return e->parent;
+}
+
+/* Returns the number of elements in TREE. */
+size_t
+rb_size (const struct rb_tree *tree)
+{
+  ASSERT (tree != NULL);
+
+  return tree->size;
+}
+
+/* Returns true if TREE is empty, false otherwise. */
+bool
+rb_empty (const struct rb_tree *tree)
+{
+  ASSERT (tree != NULL);
+
+  return tree->root == NULL;
+}
+
+/* Rotates E, which must have a right child, down to the left in
+   TREE, so that its right child takes its place. */
+static void
+rotate_left (struct rb_tree *tree, struct rb_elem *e)
+{
+  struct rb_elem *r = e->right;
+
+  e->right = r->left;
+  if (r->left != NULL)
+    r->left->parent = e;
+  transplant (tree, e, r);
+  r->left = e;
+  e->parent = r;
+
+  update (tree, e);
+  update (tree, r);
+}
+
+/* Rotates E, which must have a left child, down to the right in
+   TREE, so that its left child takes its place. */
+static void
+rotate_right (struct rb_tree *tree, struct rb_elem *e)
+{
+  struct rb_elem *l = e->left;
+
+  e->left = l->right;
+  if (l->right != NULL)
+    l->right->parent = e;
+  transplant (tree, e, l);
+  l->right = e;
+  e->parent = l;
+
+  update (tree, e);
+  update (tree, l);
+}
+
+/* Restores the red-black invariants in TREE after red element E
+   has been inserted. */
+static void
+insert_fixup (struct rb_tree *tree, struct rb_elem *e)
+{
+  struct rb_elem *parent;
+
+  while (is_red (parent = e->parent))
+    {
+      /* PARENT is red, so it is not the root. */
+      struct rb_elem *grandparent = parent->parent;
+
+      if (parent == grandparent->left)
+        {
+          struct rb_elem *uncle = grandparent->right;
+          if (is_red (uncle))
+            {
+              /* Push the grandparent's blackness down and carry
+                 on from the grandparent. */
+              parent->red = uncle->red = false;
+              grandparent->red = true;
+              e = grandparent;
+            }
+          else
+            {
+              if (e == parent->right)
+                {
+                  rotate_left (tree, parent);
+                  parent = e;
+                }
+              parent->red = false;
+              grandparent->red = true;
+              rotate_right (tree, grandparent);
+              break;
+            }
+        }
+      else
+        {
+          struct rb_elem *uncle = grandparent->left;
+          if (is_red (uncle))
+            {
+              parent->red = uncle->red = false;
+              grandparent->red = true;
+              e = grandparent;
+            }
+          else
+            {
+              if (e == parent->left)
+                {
+                  rotate_right (tree, parent);
+                  parent = e;
+                }
+              parent->red = false;
+              grandparent->red = true;
+              rotate_left (tree, grandparent);
+              break;
+            }
+        }
+    }
+  tree->root->red = false;
+}
+
+/* Restores the red-black invariants in TREE after a black
+   element has been removed from between PARENT and E, its new
+   child, which may be null.  Paths through E are one black
+   element short. */
+static void
+remove_fixup (struct rb_tree *tree, struct rb_elem *e,
+              struct rb_elem *parent)
+{
+  while (e != tree->root && !is_red (e))
+    {
+      /* E's sibling is not null, because paths through it have
+         at least one more black element than paths through E. */
+      if (e == parent->left)
+        {
+          struct rb_elem *sibling = parent->right;
+          if (sibling->red)
+            {
+              sibling->red = false;
+              parent->red = true;
+              rotate_left (tree, parent);
+              sibling = parent->right;
+            }
+          if (!is_red (sibling->left) && !is_red (sibling->right))
+            {
+              /* Take a black element off the sibling's side too
+                 and push the shortage up to the parent. */
+              sibling->red = true;
+              e = parent;
+              parent = e->parent;
+            }
+          else
+            {
+              if (!is_red (sibling->right))
+                {
+                  sibling->left->red = false;
+                  sibling->red = true;
+                  rotate_right (tree, sibling);
+                  sibling = parent->right;
+                }
+              sibling->red = parent->red;
+              parent->red = false;
+              sibling->right->red = false;
+              rotate_left (tree, parent);
+              e = tree->root;
+            }
+        }
+      else
+        {
+          struct rb_elem *sibling = parent->left;
+          if (sibling->red)
+            {
+              sibling->red = false;
+              parent->red = true;
+              rotate_right (tree, parent);
+              sibling = parent->left;
+            }
+          if (!is_red (sibling->left) && !is_red (sibling->right))
+            {
+              sibling->red = true;
+              e = parent;
+              parent = e->parent;
+            }
+          else
+            {
+              if (!is_red (sibling->left))
+                {
+                  sibling->right->red = false;
+                  sibling->red = true;
+                  rotate_left (tree, sibling);
+                  sibling = parent->left;
+                }
+              sibling->red = parent->red;
+              parent->red = false;
+              sibling->left->red = false;
+              rotate_right (tree, parent);
+              e = tree->root;
+            }
+        }
+    }
+  if (e != NULL)
+    e->red = false;
+}
@@ -0,0 +1,109 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Red-black tree.
+
+   A balanced binary search tree that keeps its elements in the
+   order given by an rb_less_func, so that insertion, removal and
+   searches, including for the first element not less than a key
+   (rb_lower_bound()), take O(log n) time, and iterating over all
+   the elements in order takes O(n).  Use it instead of a list
+   kept sorted with list_insert_ordered() whenever the list can
+   grow long.
+
+   Like struct list, the tree does not require dynamically
+   allocated memory: each structure that is a potential tree
+   element must embed a struct rb_elem member, and rb_entry()
+   converts from a struct rb_elem back to the structure that
+   contains it, just like list_entry().
+
+   Elements that compare equal are allowed.  A new element is
+   inserted after any elements equal to it, so that equal
+   elements come out in first-in, first-out order.
+
+   Iteration idiom:
+
+      struct rb_elem *e;
+
+      for (e = rb_first (&tree); e != NULL; e = rb_next (e))
+        {
+          struct foo *f = rb_entry (e, struct foo, elem);
+          ...do something with f...
+        }
+
+   If the key of an element changes while it is in a tree, it
+   must be removed and inserted again.
+
+   A tree may also be "augmented" by giving rb_init() an
+   rb_update_func, which the tree calls to recompute an element's
+   data from its children's whenever the subtree below the
+   element changes.  lib/kernel/interval.h uses this to build an
+   interval tree. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Tree element. */
+struct rb_elem
+  {
+    struct rb_elem *parent;     /* Parent, or null at the root. */
+    struct rb_elem *left;       /* Left child, or null. */
+    struct rb_elem *right;      /* Right child, or null. */
+    bool red;                   /* True if red, false if black. */
+  };
+
+/* Converts pointer to tree element RB_ELEM into a pointer to the
+   structure that RB_ELEM is embedded inside.  Supply the name of
+   the outer structure STRUCT and the member name MEMBER of the
+   tree element. */
+#define rb_entry(RB_ELEM, STRUCT, MEMBER)               \
+        ((STRUCT *) ((uint8_t *) &(RB_ELEM)->parent     \
+                     - offsetof (STRUCT, MEMBER.parent)))
+
+/* Compares the value of two tree elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool rb_less_func (const struct rb_elem *a,
+                           const struct rb_elem *b,
+                           void *aux);
+
+/* Recomputes the augmented data of tree element E from E itself
+   and its children, given auxiliary data AUX. */
+typedef void rb_update_func (struct rb_elem *e, void *aux);
+
+/* Red-black tree. */
+struct rb_tree
+  {
+    struct rb_elem *root;       /* Root element, or null. */
+    size_t size;                /* Number of elements. */
+    rb_less_func *less;         /* Comparison function. */
+    rb_update_func *update;     /* Augmentation function, or null. */
+    void *aux;                  /* Auxiliary data for `less', `update'. */
+  };
+
+void rb_init (struct rb_tree *, rb_less_func *, rb_update_func *,
+              void *aux);
+
+/* Insertion and removal. */
+void rb_insert (struct rb_tree *, struct rb_elem *);
+void rb_remove (struct rb_tree *, struct rb_elem *);
+
+/* Searching. */
+struct rb_elem *rb_find (const struct rb_tree *, const struct rb_elem *);
+struct rb_elem *rb_lower_bound (const struct rb_tree *,
+                                const struct rb_elem *);
+struct rb_elem *rb_upper_bound (const struct rb_tree *,
+                                const struct rb_elem *);
+
+/* Ordered traversal. */
+struct rb_elem *rb_first (const struct rb_tree *);
+struct rb_elem *rb_last (const struct rb_tree *);
+struct rb_elem *rb_next (const struct rb_elem *);
+struct rb_elem *rb_prev (const struct rb_elem *);
+
+/* Properties. */
+size_t rb_size (const struct rb_tree *);
+bool rb_empty (const struct rb_tree *);
+
+#endif /* lib/kernel/rbtree.h */
@@ -0,0 +1,159 @@
+/* Test program for lib/kernel/interval.c.
+
+   Inserts and removes random intervals in random order, and
+   after every change checks each subtree's `max_end' and
+   compares the intervals found overlapping a variety of ranges
+   against a brute-force search.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <interval.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Maximum number of intervals in a tree that we will test. */
+#define MAX_SIZE 64
+
+/* Intervals lie within [0, RANGE). */
+#define RANGE 100
+
+/* An interval. */
+struct value
+  {
+    struct interval_elem elem;  /* Interval tree element. */
+    bool in_tree;               /* True if in the tree. */
+  };
+
+static void shuffle (struct value *[], size_t);
+static uintptr_t verify_subtree (struct rb_elem *);
+static void verify_overlaps (struct interval_tree *, struct value[],
+                             int cnt);
+
+/* Test the interval tree implementation. */
+void
+test (void)
+{
+  int size;
+
+  printf ("testing various size interval trees:");
+  for (size = 0; size < MAX_SIZE; size++)
+    {
+      int repeat;
+
+      printf (" %d", size);
+      for (repeat = 0; repeat < 10; repeat++)
+        {
+          static struct value values[MAX_SIZE];
+          static struct value *order[MAX_SIZE];
+          struct interval_tree tree;
+          int i;
+
+          /* Insert SIZE random intervals, short and long. */
+          interval_init (&tree);
+          for (i = 0; i < size; i++)
+            {
+              uintptr_t start = random_ulong () % RANGE;
+              uintptr_t len = 1 + random_ulong () % (i % 2 ? 5 : RANGE / 2);
+
+              interval_insert (&tree, &values[i].elem, start, start + len);
+              values[i].in_tree = true;
+              order[i] = &values[i];
+              verify_subtree (tree.tree.root);
+              verify_overlaps (&tree, values, i + 1);
+            }
+          ASSERT (interval_size (&tree) == (size_t) size);
+
+          /* Remove them in random order. */
+          shuffle (order, size);
+          for (i = 0; i < size; i++)
+            {
+              interval_remove (&tree, &order[i]->elem);
+              order[i]->in_tree = false;
+              verify_subtree (tree.tree.root);
+              verify_overlaps (&tree, values, size);
+            }
+          ASSERT (interval_empty (&tree));
+        }
+    }
+
+  printf (" done\n");
+  printf ("interval: PASS\n");
+}
+
+/* Shuffles the CNT elements in ARRAY into random order. */
+static void
+shuffle (struct value **array, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      size_t j = i + random_ulong () % (cnt - i);
+      struct value *t = array[j];
+      array[j] = array[i];
+      array[i] = t;
+    }
+}
+
+/* Verifies `max_end' in each element in the subtree rooted at E
+   and returns the greatest `end' in it, or 0 if E is null. */
+static uintptr_t
+verify_subtree (struct rb_elem *e)
+{
+  struct interval_elem *i;
+  uintptr_t max, left, right;
+
+  if (e == NULL)
+    return 0;
+
+  i = rb_entry (e, struct interval_elem, rb_elem);
+  left = verify_subtree (e->left);
+  right = verify_subtree (e->right);
+  max = i->end;
+  if (left > max)
+    max = left;
+  if (right > max)
+    max = right;
+  ASSERT (i->max_end == max);
+  return max;
+}
+
+/* Verifies that, for a variety of ranges, TREE yields exactly
+   those of the first CNT VALUES that are in TREE and overlap the
+   range, in order of their starts. */
+static void
+verify_overlaps (struct interval_tree *tree, struct value values[], int cnt)
+{
+  uintptr_t start;
+
+  for (start = 0; start <= RANGE; start += 3)
+    {
+      uintptr_t end = start + 1 + start % 11;
+      struct interval_elem *e;
+      int expected = 0, found = 0;
+      uintptr_t prev_start = 0;
+      int i;
+
+      for (i = 0; i < cnt; i++)
+        if (values[i].in_tree && values[i].elem.start < end
+            && values[i].elem.end > start)
+          expected++;
+
+      for (e = interval_first (tree, start, end); e != NULL;
+           e = interval_next (e, start, end))
+        {
+          struct value *v = interval_entry (e, struct value, elem);
+          ASSERT (v->in_tree);
+          ASSERT (e->start < end && e->end > start);
+          ASSERT (e->start >= prev_start);
+          prev_start = e->start;
+          found++;
+        }
+      ASSERT (found == expected);
+    }
+}
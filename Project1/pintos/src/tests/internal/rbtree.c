@@ -0,0 +1,202 @@
+/* Test program for lib/kernel/rbtree.c.
+
+   Builds red-black trees of various sizes by inserting and
+   removing elements in random order, checking the red-black
+   invariants, the ordering, and the searches after every change.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <rbtree.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Maximum number of elements in a tree that we will test. */
+#define MAX_SIZE 64
+
+/* A tree element. */
+struct value
+  {
+    struct rb_elem elem;        /* Tree element. */
+    int value;                  /* Item value. */
+    int seq;                    /* Order of insertion. */
+  };
+
+static void shuffle (struct value *[], size_t);
+static bool value_less (const struct rb_elem *, const struct rb_elem *,
+                        void *);
+static void verify_tree (struct rb_tree *, int size);
+static int verify_subtree (struct rb_elem *);
+static void verify_bounds (struct rb_tree *, int max_value);
+
+/* Test the red-black tree implementation. */
+void
+test (void)
+{
+  int size;
+
+  printf ("testing various size trees:");
+  for (size = 0; size < MAX_SIZE; size++)
+    {
+      int repeat;
+
+      printf (" %d", size);
+      for (repeat = 0; repeat < 10; repeat++)
+        {
+          static struct value values[MAX_SIZE];
+          static struct value *order[MAX_SIZE];
+          struct rb_tree tree;
+          int i;
+
+          /* Put values 0...(SIZE - 1) / 2, most of them twice, in VALUES,
+             and point ORDER to them in random order. */
+          for (i = 0; i < size; i++)
+            {
+              values[i].value = i / 2;
+              order[i] = &values[i];
+            }
+          shuffle (order, size);
+
+          /* Insert them, verifying the tree each time. */
+          rb_init (&tree, value_less, NULL, NULL);
+          for (i = 0; i < size; i++)
+            {
+              order[i]->seq = i;
+              rb_insert (&tree, &order[i]->elem);
+              verify_tree (&tree, i + 1);
+            }
+          verify_bounds (&tree, (size - 1) / 2);
+
+          /* Remove them in a different random order, verifying
+             the tree each time. */
+          shuffle (order, size);
+          for (i = 0; i < size; i++)
+            {
+              rb_remove (&tree, &order[i]->elem);
+              verify_tree (&tree, size - i - 1);
+            }
+          ASSERT (rb_empty (&tree));
+          ASSERT (rb_first (&tree) == NULL);
+          ASSERT (rb_last (&tree) == NULL);
+        }
+    }
+
+  printf (" done\n");
+  printf ("rbtree: PASS\n");
+}
+
+/* Shuffles the CNT elements in ARRAY into random order. */
+static void
+shuffle (struct value **array, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      size_t j = i + random_ulong () % (cnt - i);
+      struct value *t = array[j];
+      array[j] = array[i];
+      array[i] = t;
+    }
+}
+
+/* Returns true if value A is less than value B, false
+   otherwise. */
+static bool
+value_less (const struct rb_elem *a_, const struct rb_elem *b_,
+            void *aux UNUSED)
+{
+  const struct value *a = rb_entry (a_, struct value, elem);
+  const struct value *b = rb_entry (b_, struct value, elem);
+
+  return a->value < b->value;
+}
+
+/* Verifies that TREE holds SIZE elements, satisfies the
+   red-black invariants, and is in order in both directions, with
+   equal values in order of insertion. */
+static void
+verify_tree (struct rb_tree *tree, int size)
+{
+  struct rb_elem *e, *prev;
+  int i;
+
+  ASSERT (rb_size (tree) == (size_t) size);
+  ASSERT (rb_empty (tree) == (size == 0));
+  ASSERT (tree->root == NULL || !tree->root->red);
+  ASSERT (tree->root == NULL || tree->root->parent == NULL);
+  verify_subtree (tree->root);
+
+  for (i = 0, prev = NULL, e = rb_first (tree); e != NULL;
+       i++, prev = e, e = rb_next (e))
+    {
+      ASSERT (rb_prev (e) == prev);
+      if (prev != NULL)
+        {
+          struct value *a = rb_entry (prev, struct value, elem);
+          struct value *b = rb_entry (e, struct value, elem);
+          ASSERT (a->value < b->value
+                  || (a->value == b->value && a->seq < b->seq));
+        }
+    }
+  ASSERT (i == size);
+  ASSERT (rb_last (tree) == prev);
+}
+
+/* Verifies the links and colors in the subtree rooted at E and
+   returns the number of black elements on each path down from E
+   to a missing child. */
+static int
+verify_subtree (struct rb_elem *e)
+{
+  int left, right;
+
+  if (e == NULL)
+    return 1;
+
+  ASSERT (e->left == NULL || e->left->parent == e);
+  ASSERT (e->right == NULL || e->right->parent == e);
+  if (e->red)
+    ASSERT ((e->left == NULL || !e->left->red)
+            && (e->right == NULL || !e->right->red));
+
+  left = verify_subtree (e->left);
+  right = verify_subtree (e->right);
+  ASSERT (left == right);
+  return left + !e->red;
+}
+
+/* Verifies rb_find(), rb_lower_bound() and rb_upper_bound() in
+   TREE, which must hold values between 0 and MAX_VALUE, for each
+   of those values and one past either end. */
+static void
+verify_bounds (struct rb_tree *tree, int max_value)
+{
+  struct value key;
+
+  for (key.value = -1; key.value <= max_value + 1; key.value++)
+    {
+      struct rb_elem *lower = rb_lower_bound (tree, &key.elem);
+      struct rb_elem *upper = rb_upper_bound (tree, &key.elem);
+      struct rb_elem *found = rb_find (tree, &key.elem);
+      struct rb_elem *e;
+      struct value *v;
+
+      /* The bounds are the first element at least KEY and the
+         first greater than KEY. */
+      for (e = rb_first (tree); e != NULL; e = rb_next (e))
+        if (rb_entry (e, struct value, elem)->value >= key.value)
+          break;
+      ASSERT (lower == e);
+      v = e != NULL ? rb_entry (e, struct value, elem) : NULL;
+      ASSERT (found == (v != NULL && v->value == key.value ? e : NULL));
+      for (; e != NULL; e = rb_next (e))
+        if (rb_entry (e, struct value, elem)->value > key.value)
+          break;
+      ASSERT (upper == e);
+    }
+}
@@ -0,0 +1,113 @@
+/* Measures the cost of creating a thread and waiting for it to
+   exit, first with the thread page cache turned off, so that
+   every thread gets a fresh page from the page allocator, and
+   then with it turned on.
+
+   Each thread has a higher priority than the main thread, so it
+   runs and exits as soon as it is created, and the main thread
+   then waits for it, so that only one is alive at a time.
+
+   The cycle counts are only reported.  What is checked is that
+   every thread ran, and that no thread pages leaked: the number
+   of free kernel pages must be the same before and after the
+   uncached run, and the cached run, which reuses the same page
+   over and over, may keep at most one more page in the cache. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 1000
+
+static thread_func exit_thread;
+
+static struct semaphore done;   /* Up'd by each thread on exit. */
+static int run_cnt;             /* Number of threads that ran. */
+
+static void bench_create (bool cache);
+static size_t free_page_cnt (void);
+
+void
+test_bench_create (void) 
+{
+  bool cache = thread_cache_enabled;
+  size_t before, after;
+
+  sema_init (&done, 0);
+
+  before = free_page_cnt ();
+  bench_create (false);
+  after = free_page_cnt ();
+  if (after != before)
+    fail ("%zu free pages before uncached run, %zu after", before, after);
+  msg ("cache off: free pages conserved.");
+
+  bench_create (true);
+  after = free_page_cnt ();
+  if (after + 1 < before || after > before)
+    fail ("%zu free pages before cached run, %zu after", before, after);
+  msg ("cache on: at most one page kept in the cache.");
+
+  thread_cache_enabled = cache;
+}
+
+static void
+bench_create (bool cache) 
+{
+  uint64_t start, cycles;
+  int i;
+
+  thread_cache_enabled = cache;
+  run_cnt = 0;
+
+  start = timer_cycles ();
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      tid_t tid = thread_create ("exit", PRI_DEFAULT + 1, exit_thread, NULL);
+      ASSERT (tid != TID_ERROR);
+      sema_down (&done);
+    }
+  cycles = timer_cycles () - start;
+
+  if (run_cnt != THREAD_CNT)
+    fail ("%d of %d threads ran", run_cnt, THREAD_CNT);
+  msg ("create+join: cache %s, %d threads, %"PRIu64" cycles per thread.",
+       cache ? "on" : "off", THREAD_CNT, cycles / THREAD_CNT);
+}
+
+static void
+exit_thread (void *aux UNUSED) 
+{
+  run_cnt++;
+  sema_up (&done);
+}
+
+/* Returns the number of pages that can be obtained from the
+   kernel pool right now, freeing them again before returning.
+   The pages are linked together through their first word. */
+static size_t
+free_page_cnt (void) 
+{
+  void *list = NULL;
+  size_t cnt = 0;
+  void *page;
+
+  while ((page = palloc_get_page (0)) != NULL) 
+    {
+      *(void **) page = list;
+      list = page;
+      cnt++;
+    }
+  while (list != NULL) 
+    {
+      page = list;
+      list = *(void **) page;
+      palloc_free_page (page);
+    }
+  return cnt;
+}
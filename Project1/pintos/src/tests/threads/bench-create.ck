@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# The test itself checks that pages are conserved; here make sure
+# it got that far and reported both timings.
+fail "uncached run leaked pages\n"
+  if !grep (/cache off: free pages conserved\./, @output);
+fail "cached run leaked pages\n"
+  if !grep (/cache on: at most one page kept in the cache\./, @output);
+fail "uncached create+join time missing\n"
+  if !grep (/create\+join: cache off, \d+ threads, \d+ cycles per thread\./,
+            @output);
+fail "cached create+join time missing\n"
+  if !grep (/create\+join: cache on, \d+ threads, \d+ cycles per thread\./,
+            @output);
+pass;
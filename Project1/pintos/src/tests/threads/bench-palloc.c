@@ -0,0 +1,241 @@
+/* Measures the page allocator: first the cost of getting and
+   freeing a single page, then a mixed workload that keeps up to
+   SLOT_CNT blocks of 1 to 4 pages allocated at random, and how
+   large a contiguous block can still be obtained while that
+   workload holds its blocks.
+
+   Along the way it checks the allocator's results.  Every page
+   of a block is tagged when the block is obtained and the tags
+   are checked when it is freed, to catch blocks that overlap.
+   The number of free pages must be the same after the workload
+   as before it.  Finally, with the pool otherwise used up, six
+   free pages that lie side by side across four buddy blocks must
+   still be obtainable in a single request. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <random.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define SINGLE_CNT 10000        /* Single-page get+free pairs. */
+#define MIXED_CNT 10000         /* Mixed-workload operations. */
+#define SLOT_CNT 32             /* Blocks held by mixed workload. */
+#define LARGEST_MAX 1024        /* Largest block to try for. */
+
+static void bench_single (void);
+static void bench_mixed (void);
+static void tag_block (void *, size_t page_cnt, int tag);
+static void check_block (void *, size_t page_cnt);
+static size_t largest_block (void);
+static void check_split_run (void);
+static size_t free_page_cnt (void);
+
+void
+test_bench_palloc (void) 
+{
+  bench_single ();
+  bench_mixed ();
+  check_split_run ();
+}
+
+static void
+bench_single (void) 
+{
+  uint64_t get_cycles = 0, free_cycles = 0;
+  int i;
+
+  for (i = 0; i < SINGLE_CNT; i++) 
+    {
+      uint64_t start = timer_cycles ();
+      void *page = palloc_get_page (PAL_ASSERT);
+      uint64_t mid = timer_cycles ();
+      palloc_free_page (page);
+      free_cycles += timer_cycles () - mid;
+      get_cycles += mid - start;
+    }
+
+  msg ("single page: %"PRIu64" cycles per get, %"PRIu64" cycles per free.",
+       get_cycles / SINGLE_CNT, free_cycles / SINGLE_CNT);
+}
+
+static void
+bench_mixed (void) 
+{
+  void *pages[SLOT_CNT];
+  size_t cnts[SLOT_CNT];
+  uint64_t get_cycles = 0, free_cycles = 0;
+  int get_cnt = 0, free_cnt = 0, fail_cnt = 0;
+  size_t before, after;
+  int i;
+
+  before = free_page_cnt ();
+  random_init (0x5eed);
+  for (i = 0; i < SLOT_CNT; i++)
+    pages[i] = NULL;
+
+  for (i = 0; i < MIXED_CNT; i++) 
+    {
+      int slot = random_ulong () % SLOT_CNT;
+      uint64_t start = timer_cycles ();
+
+      if (pages[slot] == NULL) 
+        {
+          cnts[slot] = random_ulong () % 4 + 1;
+          pages[slot] = palloc_get_multiple (0, cnts[slot]);
+          get_cycles += timer_cycles () - start;
+          get_cnt++;
+          if (pages[slot] == NULL)
+            fail_cnt++;
+          else
+            tag_block (pages[slot], cnts[slot], i);
+        }
+      else 
+        {
+          check_block (pages[slot], cnts[slot]);
+          start = timer_cycles ();
+          palloc_free_multiple (pages[slot], cnts[slot]);
+          free_cycles += timer_cycles () - start;
+          free_cnt++;
+          pages[slot] = NULL;
+        }
+    }
+
+  msg ("largest block with the workload's blocks held: %zu pages.",
+       largest_block ());
+
+  for (i = 0; i < SLOT_CNT; i++)
+    if (pages[i] != NULL) 
+      {
+        check_block (pages[i], cnts[i]);
+        palloc_free_multiple (pages[i], cnts[i]);
+      }
+
+  msg ("mixed: %"PRIu64" cycles per get, %"PRIu64" cycles per free, "
+       "%d failures.",
+       get_cnt ? get_cycles / get_cnt : 0,
+       free_cnt ? free_cycles / free_cnt : 0, fail_cnt);
+
+  after = free_page_cnt ();
+  if (after != before)
+    fail ("%zu free pages before mixed workload, %zu after", before, after);
+  msg ("mixed: free pages conserved.");
+}
+
+/* Writes TAG into the first word of each of the PAGE_CNT pages
+   starting at PAGES, followed by the page's index in the
+   block. */
+static void
+tag_block (void *pages, size_t page_cnt, int tag) 
+{
+  size_t i;
+
+  for (i = 0; i < page_cnt; i++) 
+    {
+      int *p = (int *) ((uint8_t *) pages + i * PGSIZE);
+      p[0] = tag;
+      p[1] = i;
+    }
+}
+
+/* Checks that the PAGE_CNT pages starting at PAGES still carry
+   the tags that tag_block() wrote into them. */
+static void
+check_block (void *pages, size_t page_cnt) 
+{
+  int tag = *(int *) pages;
+  size_t i;
+
+  for (i = 0; i < page_cnt; i++) 
+    {
+      int *p = (int *) ((uint8_t *) pages + i * PGSIZE);
+      if (p[0] != tag || p[1] != (int) i)
+        fail ("page %zu of block at %p overwritten", i, pages);
+    }
+}
+
+/* Returns the number of pages in the largest block, up to
+   LARGEST_MAX, that palloc_get_multiple() can obtain. */
+static size_t
+largest_block (void) 
+{
+  size_t lo = 0, hi = LARGEST_MAX;
+
+  while (lo < hi) 
+    {
+      size_t mid = (lo + hi + 1) / 2;
+      void *pages = palloc_get_multiple (0, mid);
+
+      if (pages != NULL) 
+        {
+          palloc_free_multiple (pages, mid);
+          lo = mid;
+        }
+      else
+        hi = mid - 1;
+    }
+  return lo;
+}
+
+/* Checks that a request can be met from free pages that lie side
+   by side in several buddy blocks, none of them big enough on its
+   own.  Takes an aligned 8-page block, uses up every other free
+   page, and frees pages 1 to 6 of the block, which the pool then
+   holds as blocks of 1, 2, 2 and 1 pages.  A request for 6 pages
+   must get exactly those. */
+static void
+check_split_run (void) 
+{
+  uint8_t *block = palloc_get_multiple (PAL_ASSERT, 8);
+  void *rest = NULL;
+  void *page, *run;
+
+  while ((page = palloc_get_page (0)) != NULL) 
+    {
+      *(void **) page = rest;
+      rest = page;
+    }
+
+  palloc_free_multiple (block + PGSIZE, 6);
+  run = palloc_get_multiple (0, 6);
+  if (run != block + PGSIZE)
+    fail ("6-page request got %p, expected %p", run, block + PGSIZE);
+  palloc_free_multiple (block, 8);
+
+  while (rest != NULL) 
+    {
+      page = rest;
+      rest = *(void **) page;
+      palloc_free_page (page);
+    }
+
+  msg ("split run: 6 pages obtained from 4 free blocks.");
+}
+
+/* Returns the number of pages that can be obtained from the
+   kernel pool right now, freeing them again before returning.
+   The pages are linked together through their first word. */
+static size_t
+free_page_cnt (void) 
+{
+  void *list = NULL;
+  size_t cnt = 0;
+  void *page;
+
+  while ((page = palloc_get_page (0)) != NULL) 
+    {
+      *(void **) page = list;
+      list = page;
+      cnt++;
+    }
+  while (list != NULL) 
+    {
+      page = list;
+      list = *(void **) page;
+      palloc_free_page (page);
+    }
+  return cnt;
+}
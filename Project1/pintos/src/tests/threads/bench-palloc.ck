@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# The test checks the allocator's results itself; make sure it
+# got through every check and reported the measurements.
+fail "single-page times missing\n"
+  if !grep (/single page: \d+ cycles per get, \d+ cycles per free\./,
+            @output);
+fail "largest block missing\n"
+  if !grep (/largest block with the workload's blocks held: \d+ pages\./,
+            @output);
+fail "mixed workload times missing\n"
+  if !grep (/mixed: \d+ cycles per get, \d+ cycles per free, \d+ failures\./,
+            @output);
+fail "mixed workload leaked pages\n"
+  if !grep (/mixed: free pages conserved\./, @output);
+fail "split run not obtained\n"
+  if !grep (/split run: 6 pages obtained from 4 free blocks\./, @output);
+pass;
@@ -0,0 +1,175 @@
+/* Measures the scheduler with hundreds of ready threads.
+
+   First, THREAD_CNT threads of equal priority each yield
+   YIELD_CNT times, and we report the average cost of a context
+   switch.  Second, with THREAD_CNT threads of assorted lower
+   priorities sitting in the run queue, we repeatedly wake a
+   high-priority thread blocked on a semaphore and report the
+   average time from sema_up() until that thread runs.
+
+   The scheduling decisions are checked along the way.  The
+   yielding threads must take their turns in strict round-robin
+   order, in the order they were created.  Each sema_up() must
+   run the high-priority thread before it returns, and none of
+   the lower-priority threads may run until the main thread
+   blocks. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 256
+#define YIELD_CNT 16
+#define WAKEUP_CNT 1000
+
+static thread_func yield_thread, filler_thread, wakee_thread;
+
+static struct semaphore done;   /* Up'd by each thread on exit. */
+static struct semaphore wake;   /* Wakes the wakee thread. */
+static volatile bool stop;      /* Tells fillers to exit. */
+static uint64_t wake_start;     /* Time of last sema_up(&wake). */
+static uint64_t wake_cycles;    /* Total wakeup latency. */
+
+static int ids[THREAD_CNT];     /* Yield thread numbers. */
+static int turn;                /* Turns taken by yield threads. */
+static int turn_errors;         /* Turns taken out of order. */
+static volatile int wake_cnt;   /* Times the wakee has woken. */
+static volatile int filler_runs; /* Times the fillers have run. */
+
+static void bench_yield (void);
+static void bench_wakeup (void);
+
+void
+test_bench_sched (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+  sema_init (&wake, 0);
+  bench_yield ();
+  bench_wakeup ();
+}
+
+static void
+bench_yield (void) 
+{
+  uint64_t start, cycles;
+  int i;
+
+  /* The threads cannot run until we drop to their priority. */
+  turn = turn_errors = 0;
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "yield %d", i);
+      ids[i] = i;
+      thread_create (name, PRI_DEFAULT - 1, yield_thread, &ids[i]);
+    }
+
+  start = timer_cycles ();
+  thread_set_priority (PRI_DEFAULT - 1);
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done);
+  cycles = timer_cycles () - start;
+  thread_set_priority (PRI_DEFAULT);
+
+  msg ("yield: %d threads, %"PRIu64" cycles per switch.",
+       THREAD_CNT, cycles / (THREAD_CNT * (YIELD_CNT + 1)));
+  if (turn_errors != 0)
+    fail ("%d of %d turns taken out of round-robin order",
+          turn_errors, THREAD_CNT * YIELD_CNT);
+  msg ("yield: turns taken in round-robin order.");
+}
+
+/* Yields YIELD_CNT times, checking each time that this is the
+   turn of thread *ID_ in the current round.  Interrupts stay off,
+   so that a timer tick cannot send the thread to the back of the
+   run queue in the middle of its turn. */
+static void
+yield_thread (void *id_) 
+{
+  int id = *(int *) id_;
+  int i;
+
+  intr_disable ();
+  for (i = 0; i < YIELD_CNT; i++) 
+    {
+      if (turn != i * THREAD_CNT + id)
+        turn_errors++;
+      turn++;
+      thread_yield ();
+    }
+  intr_enable ();
+  sema_up (&done);
+}
+
+static void
+bench_wakeup (void) 
+{
+  int i;
+
+  /* Fill the run queue with threads that cannot run until we
+     block. */
+  stop = false;
+  filler_runs = 0;
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "filler %d", i);
+      thread_create (name, PRI_MIN + 1 + i % (PRI_DEFAULT - 1),
+                     filler_thread, NULL);
+    }
+
+  /* Each sema_up() runs the wakee at once, which records the
+     latency and blocks again. */
+  wake_cycles = 0;
+  wake_cnt = 0;
+  thread_create ("wakee", PRI_DEFAULT + 1, wakee_thread, NULL);
+  for (i = 0; i < WAKEUP_CNT; i++) 
+    {
+      wake_start = timer_cycles ();
+      sema_up (&wake);
+      if (wake_cnt != i + 1)
+        fail ("wakee had woken %d times after sema_up %d", wake_cnt, i + 1);
+    }
+  if (filler_runs != 0)
+    fail ("lower-priority fillers ran %d times", filler_runs);
+
+  stop = true;
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done);
+
+  msg ("wakeup: %d ready threads, %"PRIu64" cycles per wakeup.",
+       THREAD_CNT, wake_cycles / WAKEUP_CNT);
+  msg ("wakeup: the wakee preempted every time.");
+}
+
+static void
+filler_thread (void *aux UNUSED) 
+{
+  while (!stop) 
+    {
+      filler_runs++;
+      thread_yield ();
+    }
+  sema_up (&done);
+}
+
+static void
+wakee_thread (void *aux UNUSED) 
+{
+  int i;
+
+  for (i = 0; i < WAKEUP_CNT; i++) 
+    {
+      sema_down (&wake);
+      wake_cycles += timer_cycles () - wake_start;
+      wake_cnt++;
+    }
+}
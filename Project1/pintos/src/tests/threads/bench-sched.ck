@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# The test checks the scheduling order itself; make sure it got
+# through both checks and reported both timings.
+fail "context switch time missing\n"
+  if !grep (/yield: \d+ threads, \d+ cycles per switch\./, @output);
+fail "round-robin check missing\n"
+  if !grep (/yield: turns taken in round-robin order\./, @output);
+fail "wakeup latency missing\n"
+  if !grep (/wakeup: \d+ ready threads, \d+ cycles per wakeup\./, @output);
+fail "preemption check missing\n"
+  if !grep (/wakeup: the wakee preempted every time\./, @output);
+pass;
@@ -0,0 +1,195 @@
+/* Measures the throughput of memcpy(), memmove(), memset(),
+   memcmp(), strlen(), strnlen(), strchr() and memchr(), in bytes
+   per CPU cycle, for blocks of several sizes, both with the
+   source (or, for memset(), the destination) aligned on a word
+   boundary and with it one byte off.  The scanning functions are
+   run over a string of SIZE - 1 bytes plus its terminator,
+   strchr() and memchr() look for a byte that is not there, and
+   memcmp() compares blocks that differ only in their last byte,
+   so that every function has to go all the way through.
+
+   The result of the last call of each measurement is checked.
+   Separately, memmove() is checked against a byte-by-byte copy
+   for overlapping blocks, with the destination both above and
+   below the source, over a range of distances, alignments and
+   lengths. */
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define BUF_PAGES 2             /* Pages in each buffer. */
+#define TOTAL_BYTES (256 * 1024) /* Bytes processed per measurement. */
+
+static const size_t sizes[] = {16, 64, 256, 1024, 4096};
+#define SIZE_CNT (sizeof sizes / sizeof *sizes)
+
+static uint8_t *src, *dst;
+
+static void bench (const char *name, size_t size, int ofs);
+static void check_memmove_overlap (void);
+static void report (const char *name, size_t size, int ofs,
+                    uint64_t cycles);
+
+void
+test_bench_string (void) 
+{
+  static const char *names[] = {"memcpy", "memmove", "memset", "memcmp",
+                                "strlen", "strnlen", "strchr", "memchr"};
+  size_t i, j;
+  int ofs;
+
+  src = palloc_get_multiple (PAL_ASSERT, BUF_PAGES);
+  dst = palloc_get_multiple (PAL_ASSERT, BUF_PAGES);
+  for (i = 0; i < BUF_PAGES * PGSIZE; i++)
+    src[i] = i * 7;
+
+  for (j = 0; j < sizeof names / sizeof *names; j++)
+    for (i = 0; i < SIZE_CNT; i++)
+      for (ofs = 0; ofs < 2; ofs++)
+        bench (names[j], sizes[i], ofs);
+  check_memmove_overlap ();
+
+  palloc_free_multiple (src, BUF_PAGES);
+  palloc_free_multiple (dst, BUF_PAGES);
+}
+
+/* Times TOTAL_BYTES worth of calls to the function NAME on
+   blocks of SIZE bytes, with the unaligned operand OFS bytes off
+   a word boundary, and checks the result. */
+static void
+bench (const char *name, size_t size, int ofs) 
+{
+  int iterations = TOTAL_BYTES / size;
+  const char *string = (const char *) dst + ofs;
+  uint64_t start;
+  int i, result = 0;
+  size_t length = 0;
+  const void *found = NULL;
+
+  memset (dst, 0, BUF_PAGES * PGSIZE);
+  if (name[0] != 'm' || !strcmp (name, "memchr"))
+    memset (dst + ofs, 'x', size - 1);
+  else if (!strcmp (name, "memcmp")) 
+    {
+      memcpy (dst, src + ofs, size);
+      dst[size - 1] ^= 0x80;
+    }
+
+  start = timer_cycles ();
+  if (!strcmp (name, "memcpy"))
+    for (i = 0; i < iterations; i++)
+      memcpy (dst, src + ofs, size);
+  else if (!strcmp (name, "memmove"))
+    for (i = 0; i < iterations; i++)
+      memmove (dst, src + ofs, size);
+  else if (!strcmp (name, "memset"))
+    for (i = 0; i < iterations; i++)
+      memset (dst + ofs, 0x5a, size);
+  else if (!strcmp (name, "memcmp"))
+    for (i = 0; i < iterations; i++)
+      result = memcmp (dst, src + ofs, size);
+  else if (!strcmp (name, "strlen"))
+    for (i = 0; i < iterations; i++)
+      length = strlen (string);
+  else if (!strcmp (name, "strnlen"))
+    for (i = 0; i < iterations; i++)
+      length = strnlen (string, size);
+  else if (!strcmp (name, "strchr"))
+    for (i = 0; i < iterations; i++)
+      found = strchr (string, 'y');
+  else
+    for (i = 0; i < iterations; i++)
+      found = memchr (string, 'y', size);
+  report (name, size, ofs, timer_cycles () - start);
+
+  /* Check the result of the last call. */
+  if (!strcmp (name, "memset")) 
+    {
+      size_t k;
+      for (k = 0; k < size; k++)
+        if (dst[ofs + k] != 0x5a)
+          fail ("memset %zu bytes, offset %d: wrong byte at %zu",
+                size, ofs, k);
+    }
+  else if (!strcmp (name, "memcmp"))
+    {
+      int expected = dst[size - 1] - src[ofs + size - 1];
+      if (result == 0 || (result < 0) != (expected < 0))
+        fail ("memcmp %zu bytes, offset %d: got %d, expected sign of %d",
+              size, ofs, result, expected);
+    }
+  else if (!strcmp (name, "strlen") || !strcmp (name, "strnlen"))
+    {
+      if (length != size - 1)
+        fail ("%s %zu bytes, offset %d: got length %zu",
+              name, size, ofs, length);
+    }
+  else if (!strcmp (name, "strchr") || !strcmp (name, "memchr"))
+    {
+      if (found != NULL)
+        fail ("%s %zu bytes, offset %d: found absent byte",
+              name, size, ofs);
+    }
+  else if (memcmp (dst, src + ofs, size) != 0)
+    fail ("%s %zu bytes, offset %d: wrong result", name, size, ofs);
+}
+
+/* Checks memmove() between overlapping blocks against a
+   byte-by-byte copy in the right direction.  The block to move
+   starts FROM bytes into DST, for several alignments, and is
+   moved by each distance in DISTS up and down, for each length
+   in LENGTHS.  DST is filled with a pattern first, so that bytes
+   outside the destination can be checked for being left alone as
+   well. */
+static void
+check_memmove_overlap (void) 
+{
+  static const size_t dists[] = {1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 64};
+  static const size_t lengths[] = {0, 1, 2, 3, 4, 7, 8, 9, 15, 16, 17,
+                                   31, 32, 33, 100, 255, 1000, 4095};
+  size_t d, l, k;
+  int from, up;
+
+  for (d = 0; d < sizeof dists / sizeof *dists; d++)
+    for (l = 0; l < sizeof lengths / sizeof *lengths; l++)
+      for (from = 64; from < 68; from++)
+        for (up = 0; up < 2; up++) 
+          {
+            size_t dist = dists[d], length = lengths[l];
+            size_t to = up ? from + dist : from - dist;
+            size_t end = from + dist + length + 16;
+
+            for (k = 0; k < end; k++)
+              dst[k] = k * 7 + 3;
+            memmove (dst + to, dst + from, length);
+
+            for (k = 0; k < end; k++) 
+              {
+                uint8_t expected = k * 7 + 3;
+                if (k >= to && k < to + length)
+                  expected = (k - to + from) * 7 + 3;
+                if (dst[k] != expected)
+                  fail ("memmove %zu bytes %s by %zu from offset %d: "
+                        "wrong byte at %zu",
+                        length, up ? "up" : "down", dist, from, k);
+              }
+          }
+  msg ("memmove: overlapping moves match a byte-by-byte copy.");
+}
+
+/* Reports that TOTAL_BYTES of calls to NAME on blocks of SIZE
+   bytes, OFS bytes off alignment, took CYCLES cycles. */
+static void
+report (const char *name, size_t size, int ofs, uint64_t cycles) 
+{
+  uint64_t per_100 = cycles > 0 ? (uint64_t) TOTAL_BYTES * 100 / cycles : 0;
+
+  msg ("%s %zu bytes, offset %d: %"PRIu64".%02"PRIu64" bytes per cycle.",
+       name, size, ofs, per_100 / 100, per_100 % 100);
+}
@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# The test checks the results itself; make sure it got through
+# the overlap check and reported every timing.
+fail "overlapping memmove check missing\n"
+  if !grep (/^\(bench-string\) memmove: overlapping moves match a byte-by-byte copy\.$/,
+	    @output);
+foreach my $func (qw (memcpy memmove memset memcmp
+		       strlen strnlen strchr memchr)) {
+    foreach my $size (16, 64, 256, 1024, 4096) {
+	foreach my $ofs (0, 1) {
+	    fail "$func $size bytes, offset $ofs missing\n"
+	      if !grep (/^\(bench-string\) $func $size bytes, offset $ofs: \d+\.\d\d bytes per cycle\.$/,
+			@output);
+	}
+    }
+}
+pass;
@@ -0,0 +1,63 @@
+/* Checks that a writer waiting for the readers of a
+   readers-writer lock to leave donates its priority to them,
+   including priority donated to the writer itself while it
+   waits.
+
+   The main thread acquires the lock for reading.  Then it
+   creates a higher-priority writer, which blocks waiting for the
+   main thread to stop reading, so the main thread should run at
+   the writer's priority.  Next it creates a reader of still
+   higher priority, which has to wait behind the writer and
+   donates to it, and the writer should pass that on to the main
+   thread.  Once the main thread releases the lock, its priority
+   should drop back to the default. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+static struct rwlock rwlock;
+
+void
+test_rwlock_donate (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rwlock);
+  rwlock_acquire_read (&rwlock);
+  thread_create ("writer", PRI_DEFAULT + 10, writer_thread_func, NULL);
+  msg ("main: priority %d while the writer waits.", thread_get_priority ());
+  thread_create ("reader", PRI_DEFAULT + 20, reader_thread_func, NULL);
+  msg ("main: priority %d while the reader waits too.",
+       thread_get_priority ());
+  rwlock_release_read (&rwlock);
+  msg ("main: priority %d after releasing the read lock.",
+       thread_get_priority ());
+}
+
+static void
+reader_thread_func (void *aux UNUSED) 
+{
+  rwlock_acquire_read (&rwlock);
+  msg ("reader: got the read lock.");
+  rwlock_release_read (&rwlock);
+}
+
+static void
+writer_thread_func (void *aux UNUSED) 
+{
+  rwlock_acquire_write (&rwlock);
+  msg ("writer: got the write lock at priority %d.",
+       thread_get_priority ());
+  rwlock_release_write (&rwlock);
+  msg ("writer: done.");
+}
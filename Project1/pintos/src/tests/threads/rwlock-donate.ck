@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-donate) begin
+(rwlock-donate) main: priority 41 while the writer waits.
+(rwlock-donate) main: priority 51 while the reader waits too.
+(rwlock-donate) writer: got the write lock at priority 51.
+(rwlock-donate) reader: got the read lock.
+(rwlock-donate) writer: done.
+(rwlock-donate) main: priority 31 after releasing the read lock.
+(rwlock-donate) end
+EOF
+pass;
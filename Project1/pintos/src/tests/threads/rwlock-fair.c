@@ -0,0 +1,70 @@
+/* Checks that a readers-writer lock lets readers share it, and
+   that readers and writers of equal priority that are kept
+   waiting are let in in the order in which they arrived.
+
+   First, the main thread acquires the lock for reading and two
+   higher-priority readers get it at the same time.  Then the
+   main thread acquires the lock for writing and creates a
+   reader, a writer and another reader, all of the same higher
+   priority, which block.  When the main thread releases the
+   lock, they should get it one after another in that order. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+static struct rwlock rwlock;
+
+void
+test_rwlock_fair (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rwlock);
+
+  rwlock_acquire_read (&rwlock);
+  msg ("main: got the read lock.");
+  thread_create ("reader 0", PRI_DEFAULT + 1, reader_thread_func, NULL);
+  thread_create ("reader 1", PRI_DEFAULT + 1, reader_thread_func, NULL);
+  msg ("main: releasing the read lock.");
+  rwlock_release_read (&rwlock);
+
+  rwlock_acquire_write (&rwlock);
+  msg ("main: got the write lock.");
+  /* The first waiter donates its priority to us, so yield to let
+     each of the others run and block too. */
+  thread_create ("reader A", PRI_DEFAULT + 1, reader_thread_func, NULL);
+  thread_create ("writer B", PRI_DEFAULT + 1, writer_thread_func, NULL);
+  thread_yield ();
+  thread_create ("reader C", PRI_DEFAULT + 1, reader_thread_func, NULL);
+  thread_yield ();
+  msg ("main: releasing the write lock.");
+  rwlock_release_write (&rwlock);
+
+  msg ("main: done.");
+}
+
+static void
+reader_thread_func (void *aux UNUSED) 
+{
+  rwlock_acquire_read (&rwlock);
+  msg ("%s: got the read lock.", thread_name ());
+  rwlock_release_read (&rwlock);
+}
+
+static void
+writer_thread_func (void *aux UNUSED) 
+{
+  rwlock_acquire_write (&rwlock);
+  msg ("%s: got the write lock.", thread_name ());
+  rwlock_release_write (&rwlock);
+}
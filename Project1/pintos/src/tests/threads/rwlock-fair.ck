@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-fair) begin
+(rwlock-fair) main: got the read lock.
+(rwlock-fair) reader 0: got the read lock.
+(rwlock-fair) reader 1: got the read lock.
+(rwlock-fair) main: releasing the read lock.
+(rwlock-fair) main: got the write lock.
+(rwlock-fair) main: releasing the write lock.
+(rwlock-fair) reader A: got the read lock.
+(rwlock-fair) writer B: got the write lock.
+(rwlock-fair) reader C: got the read lock.
+(rwlock-fair) main: done.
+(rwlock-fair) end
+EOF
+pass;
@@ -0,0 +1,60 @@
+/* Checks that a writer waiting for a readers-writer lock is not
+   starved by readers that arrive after it, and that they donate
+   their priority to it.
+
+   The main thread acquires the lock for reading.  Then it
+   creates a higher-priority writer, which blocks waiting for the
+   main thread to stop reading, followed by two readers of still
+   higher priority.  Although the lock is only held for reading,
+   the readers must wait behind the writer, and while they do the
+   writer should run at their priority.  When the main thread
+   releases the lock, the writer should get it first, then the
+   readers. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+static struct rwlock rwlock;
+
+void
+test_rwlock_writer (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rwlock);
+  rwlock_acquire_read (&rwlock);
+  thread_create ("writer", PRI_DEFAULT + 1, writer_thread_func, NULL);
+  thread_create ("reader 0", PRI_DEFAULT + 2, reader_thread_func, NULL);
+  thread_create ("reader 1", PRI_DEFAULT + 2, reader_thread_func, NULL);
+  msg ("main: releasing the read lock.");
+  rwlock_release_read (&rwlock);
+  msg ("main: done.");
+}
+
+static void
+reader_thread_func (void *aux UNUSED) 
+{
+  rwlock_acquire_read (&rwlock);
+  msg ("%s: got the read lock.", thread_name ());
+  rwlock_release_read (&rwlock);
+}
+
+static void
+writer_thread_func (void *aux UNUSED) 
+{
+  rwlock_acquire_write (&rwlock);
+  msg ("writer: got the write lock at priority %d.",
+       thread_get_priority ());
+  rwlock_release_write (&rwlock);
+  msg ("writer: done.");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-writer) begin
+(rwlock-writer) main: releasing the read lock.
+(rwlock-writer) writer: got the write lock at priority 33.
+(rwlock-writer) reader 0: got the read lock.
+(rwlock-writer) reader 1: got the read lock.
+(rwlock-writer) writer: done.
+(rwlock-writer) main: done.
+(rwlock-writer) end
+EOF
+pass;
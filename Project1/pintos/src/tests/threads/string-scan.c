@@ -0,0 +1,97 @@
+/* Checks strlen(), strnlen(), strchr() and memchr(), which look
+   at a word at a time, against simple byte-at-a-time versions,
+   for strings of many lengths starting at each offset within a
+   word, with the character sought at each position. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+
+#define LEN_MAX 70              /* Longest string checked. */
+
+static char buf[LEN_MAX + 16];
+
+static size_t byte_strlen (const char *);
+static char *byte_strchr (const char *, int);
+static void *byte_memchr (const void *, int, size_t);
+
+void
+test_string_scan (void) 
+{
+  int ofs, len, pos;
+  size_t maxlen;
+
+  for (ofs = 0; ofs < 8; ofs++)
+    for (len = 0; len <= LEN_MAX; len++) 
+      {
+        char *s = buf + ofs;
+
+        /* Use bytes with the top bit set too, which naive
+           zero-byte tests mistake for zero. */
+        memset (buf, 0x80, sizeof buf);
+        memset (s, 'a', len);
+        s[len] = '\0';
+
+        if (strlen (s) != byte_strlen (s))
+          fail ("strlen: offset %d, length %d: got %zu",
+                ofs, len, strlen (s));
+        for (maxlen = 0; maxlen <= (size_t) len + 2; maxlen++) 
+          {
+            size_t expected = len < (int) maxlen ? (size_t) len : maxlen;
+            if (strnlen (s, maxlen) != expected)
+              fail ("strnlen: offset %d, length %d, max %zu: got %zu",
+                    ofs, len, maxlen, strnlen (s, maxlen));
+          }
+
+        for (pos = 0; pos <= len; pos++) 
+          {
+            char saved = s[pos];
+            int c = pos < len ? 'b' : '\0';
+
+            s[pos] = c;
+            if (strchr (s, c) != byte_strchr (s, c))
+              fail ("strchr: offset %d, length %d, position %d",
+                    ofs, len, pos);
+            if (memchr (s, c, len) != byte_memchr (s, c, len))
+              fail ("memchr: offset %d, length %d, position %d",
+                    ofs, len, pos);
+            if (memchr (s, 0x80, len) != byte_memchr (s, 0x80, len))
+              fail ("memchr 0x80: offset %d, length %d", ofs, len);
+            s[pos] = saved;
+          }
+        if (strchr (s, 'z') != NULL)
+          fail ("strchr: offset %d, length %d: found absent char",
+                ofs, len);
+      }
+  pass ();
+}
+
+static size_t
+byte_strlen (const char *s) 
+{
+  size_t n = 0;
+  while (s[n] != '\0')
+    n++;
+  return n;
+}
+
+static char *
+byte_strchr (const char *s, int c) 
+{
+  for (;; s++)
+    if (*s == (char) c)
+      return (char *) s;
+    else if (*s == '\0')
+      return NULL;
+}
+
+static void *
+byte_memchr (const void *block_, int c, size_t size) 
+{
+  const unsigned char *block = block_;
+  for (; size-- > 0; block++)
+    if (*block == (unsigned char) c)
+      return (void *) block;
+  return NULL;
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(string-scan) begin
+(string-scan) PASS
+(string-scan) end
+EOF
+pass;
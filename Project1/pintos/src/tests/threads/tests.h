@@ -19,6 +19,9 @@ extern test_func test_priority_donate_sema;
 extern test_func test_priority_donate_nest;
 extern test_func test_priority_donate_lower;
 extern test_func test_priority_donate_chain;
+extern test_func test_rwlock_fair;
+extern test_func test_rwlock_writer;
+extern test_func test_rwlock_donate;
 extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
@@ -32,6 +35,11 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_bench_sched;
+extern test_func test_bench_create;
+extern test_func test_bench_palloc;
+extern test_func test_bench_string;
+extern test_func test_string_scan;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
@@ -5,39 +5,83 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
+#include "threads/loader.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request.
-
-   Otherwise, a new page of memory, called an "arena", is
-   obtained from the page allocator (if none is available,
-   malloc() returns a null pointer).  The new arena is divided
-   into blocks, all of which are added to the descriptor's free
-   list.  Then we return one of the new blocks.
+   The size of each request, in bytes, is rounded up to the
+   nearest "size class" and assigned to the "descriptor" that
+   manages blocks of that size.  There are four size classes for
+   each power of 2, spaced a quarter of it apart (16, 24, 32, 40,
+   48, 56, 64, 80, 96, 112, 128, 160, ...), so rounding up never
+   wastes much more than a fifth of a block.  The descriptor
+   keeps a list of free blocks.  If the free list is nonempty,
+   one of its blocks is used to satisfy the request.
+
+   Otherwise, a new "arena" is obtained from the page allocator
+   (if none is available, malloc() returns a null pointer).  The
+   new arena is divided into blocks, all of which are added to
+   the descriptor's free list.  Then we return one of the new
+   blocks.  An arena is normally a single page, but a descriptor
+   whose blocks would leave more than an eighth of a page unused
+   takes 2 or 4 pages at a time instead, whichever is the first
+   to waste no more than an eighth of the arena, so that, for
+   example, five 3 kB blocks share 4 pages instead of taking a
+   page each.  A block in the second or a later page of an arena
+   cannot find the arena header by rounding down to a page
+   boundary, so each such page is recorded in `page_arenas'.
 
    When we free a block, we add it to its descriptor's free list.
    But if the arena that the block was in now has no in-use
    blocks, we remove all of the arena's blocks from the free list
    and give the arena back to the page allocator.
 
-   We can't handle blocks bigger than 2 kB using this scheme,
-   because they're too big to fit in a single page with a
-   descriptor.  We handle those by allocating contiguous pages
-   with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   There is no size class for a block size that no arena of up
+   to ARENA_PAGES_MAX pages fits within that bound, nor for
+   blocks bigger than MAX_CLASS bytes, so the largest class is
+   3.5 kB.  Bigger blocks are not worth a size class: a class
+   would either waste more than an eighth of its arenas or pin
+   several pages for a single block, where the page allocator
+   wastes less than a page.  We handle those by allocating
+   contiguous pages with the page allocator and sticking the
+   allocation size at the beginning of the allocated block's
+   arena header.
+
+   So that most calls do not have to take a descriptor's lock,
+   which under load means waiting, priority donation, and extra
+   context switches, there is a "magazine" of up to MAG_SIZE
+   free blocks for each size class up to MAG_BLOCK_MAX bytes.
+   malloc() takes the most recently freed block from the
+   magazine, and free() puts the block back there, with
+   interrupts turned off just long enough to keep other threads
+   out of the magazine.  Only when a magazine is empty does
+   malloc() take the lock, to refill it with MAG_BATCH blocks
+   from the descriptor at once, and only when it is full does
+   free() take the lock, to return the MAG_BATCH blocks that
+   have been in it longest.  A block in a magazine still counts
+   as in use in its arena, so an arena cannot be given back to
+   the page allocator while a magazine holds any of its blocks.
+   When the page allocator runs out, whoever was asking for
+   pages, it calls malloc_reclaim() to empty the magazines back
+   into their descriptors, which may free some arenas, before
+   giving up.  For that reason malloc() never asks for pages
+   while holding a descriptor's lock. */
+
+/* Largest size class, in bytes. */
+#define MAX_CLASS PGSIZE
+
+/* Most pages in an arena. */
+#define ARENA_PAGES_MAX 4
 
 /* Descriptor. */
 struct desc
   {
     size_t block_size;          /* Size of each element in bytes. */
+    size_t arena_pages;         /* Number of pages in an arena. */
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
     struct list free_list;      /* List of free blocks. */
     struct lock lock;           /* Lock. */
@@ -60,28 +104,115 @@ struct block
     struct list_elem free_elem; /* Free list element. */
   };
 
+/* Magazines. */
+#define MAG_SIZE 16             /* Most blocks in a magazine. */
+#define MAG_BATCH 8             /* Blocks per refill or drain. */
+#define MAG_BLOCK_MAX 256       /* Largest block size in a magazine. */
+#define MAG_DESC_MAX 16         /* Most descriptors with magazines. */
+
+/* Cache of free blocks for one descriptor. */
+struct magazine
+  {
+    size_t cnt;                         /* Number of blocks. */
+    struct block *blocks[MAG_SIZE];     /* Blocks, oldest first. */
+  };
+
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[40];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Index into descs[] of the descriptor for each request size up
+   to LOOKUP_MAX bytes, in 8-byte steps, to avoid searching. */
+#define LOOKUP_MAX 1024
+static uint8_t desc_lookup[LOOKUP_MAX / 8 + 1];
+
+/* Magazines for descs[0] to descs[mag_desc_cnt - 1], those with
+   blocks no bigger than MAG_BLOCK_MAX bytes. */
+static struct magazine magazines[MAG_DESC_MAX];
+static size_t mag_desc_cnt;
+
+/* Arena owning each page of physical memory that is not the
+   first page of a multi-page arena, or a null pointer. */
+static struct arena **page_arenas;
+
+/* Pages held by the heap, now and at most. */
+static size_t heap_pages, heap_pages_peak;
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static void *get_arena_pages (size_t page_cnt);
+static void free_arena_pages (struct arena *, size_t page_cnt);
+static size_t take_blocks (struct desc *, struct block *[], size_t cnt);
+static void put_blocks (struct desc *, struct block *[], size_t cnt);
+static struct block *magazine_get (struct desc *);
+static void magazine_put (struct desc *, struct block *);
+
+/* Returns the number of pages that an arena for blocks of
+   BLOCK_SIZE bytes should have, or 0 if no arena of up to
+   ARENA_PAGES_MAX pages would waste at most an eighth of its
+   space. */
+static size_t
+arena_pages (size_t block_size) 
+{
+  size_t page_cnt;
+
+  for (page_cnt = 1; page_cnt <= ARENA_PAGES_MAX; page_cnt *= 2) 
+    {
+      size_t space = page_cnt * PGSIZE - sizeof (struct arena);
+      if (space >= block_size
+          && space % block_size <= page_cnt * PGSIZE / 8)
+        return page_cnt;
+    }
+  return 0;
+}
 
 /* Initializes the malloc() descriptors. */
 void
 malloc_init (void) 
 {
-  size_t block_size;
-
-  for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2)
+  size_t base, step, block_size;
+  size_t i;
+
+  for (base = 16; base <= MAX_CLASS; base *= 2)
+    for (step = 0; step < 4; step++)
+      {
+        struct desc *d;
+        size_t page_cnt;
+
+        /* Keep every block size a multiple of 8. */
+        block_size = base + base / 4 * step;
+        if (block_size % 8 != 0 || block_size > MAX_CLASS)
+          continue;
+
+        /* Leave sizes that no arena fits well to the page
+           allocator. */
+        page_cnt = arena_pages (block_size);
+        if (page_cnt == 0)
+          continue;
+
+        d = &descs[desc_cnt++];
+        ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
+        d->block_size = block_size;
+        d->arena_pages = page_cnt;
+        d->blocks_per_arena = ((PGSIZE * d->arena_pages
+                                - sizeof (struct arena)) / block_size);
+        list_init (&d->free_list);
+        lock_init (&d->lock);
+      }
+
+  for (i = 0, block_size = 0; block_size <= LOOKUP_MAX; block_size += 8) 
     {
-      struct desc *d = &descs[desc_cnt++];
-      ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
-      d->block_size = block_size;
-      d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
-      list_init (&d->free_list);
-      lock_init (&d->lock);
+      while (descs[i].block_size < block_size)
+        i++;
+      desc_lookup[block_size / 8] = i;
     }
+  mag_desc_cnt = desc_lookup[MAG_BLOCK_MAX / 8] + 1;
+  ASSERT (mag_desc_cnt <= MAG_DESC_MAX);
+
+  page_arenas = palloc_get_multiple (PAL_ASSERT | PAL_ZERO,
+                                     DIV_ROUND_UP (init_ram_pages
+                                                   * sizeof *page_arenas,
+                                                   PGSIZE));
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
@@ -99,15 +230,18 @@ malloc (size_t size)
 
   /* Find the smallest descriptor that satisfies a SIZE-byte
      request. */
-  for (d = descs; d < descs + desc_cnt; d++)
-    if (d->block_size >= size)
-      break;
+  if (size <= LOOKUP_MAX)
+    d = descs + desc_lookup[DIV_ROUND_UP (size, 8)];
+  else
+    for (d = descs + desc_lookup[LOOKUP_MAX / 8]; d < descs + desc_cnt; d++)
+      if (d->block_size >= size)
+        break;
   if (d == descs + desc_cnt) 
     {
       /* SIZE is too big for any descriptor.
          Allocate enough pages to hold SIZE plus an arena. */
       size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
-      a = palloc_get_multiple (0, page_cnt);
+      a = get_arena_pages (page_cnt);
       if (a == NULL)
         return NULL;
 
@@ -119,38 +253,11 @@ malloc (size_t size)
       return a + 1;
     }
 
-  lock_acquire (&d->lock);
-
-  /* If the free list is empty, create a new arena. */
-  if (list_empty (&d->free_list))
-    {
-      size_t i;
+  /* Small blocks come from the magazine. */
+  if ((size_t) (d - descs) < mag_desc_cnt)
+    return magazine_get (d);
 
-      /* Allocate a page. */
-      a = palloc_get_page (0);
-      if (a == NULL) 
-        {
-          lock_release (&d->lock);
-          return NULL; 
-        }
-
-      /* Initialize arena and add its blocks to the free list. */
-      a->magic = ARENA_MAGIC;
-      a->desc = d;
-      a->free_cnt = d->blocks_per_arena;
-      for (i = 0; i < d->blocks_per_arena; i++) 
-        {
-          struct block *b = arena_to_block (a, i);
-          list_push_back (&d->free_list, &b->free_elem);
-        }
-    }
-
-  /* Get a block from free list and return it. */
-  b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-  a = block_to_arena (b);
-  a->free_cnt--;
-  lock_release (&d->lock);
-  return b;
+  return take_blocks (d, &b, 1) > 0 ? b : NULL;
 }
 
 /* Allocates and return A times B bytes initialized to zeroes.
@@ -185,6 +292,16 @@ block_size (void *block)
   return d != NULL ? d->block_size : PGSIZE * a->free_cnt - pg_ofs (block);
 }
 
+/* Returns the number of bytes that may be used in BLOCK, which
+   must have been allocated with malloc(), calloc(), or
+   realloc().  This is at least as many as were requested, and
+   may be more.  Returns 0 if BLOCK is a null pointer. */
+size_t
+malloc_usable_size (void *block) 
+{
+  return block != NULL ? block_size (block) : 0;
+}
+
 /* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
    moving it in the process.
    If successful, returns the new block; on failure, returns a
@@ -199,6 +316,13 @@ realloc (void *old_block, size_t new_size)
       free (old_block);
       return NULL;
     }
+  else if (old_block != NULL && new_size <= block_size (old_block)
+           && new_size > block_size (old_block) / 4 * 3)
+    {
+      /* It already fits, and would not fit much more snugly in a
+         new block. */
+      return old_block;
+    }
   else 
     {
       void *new_block = malloc (new_size);
@@ -233,41 +357,239 @@ free (void *p)
           memset (b, 0xcc, d->block_size);
 #endif
   
-          lock_acquire (&d->lock);
-
-          /* Add block to free list. */
-          list_push_front (&d->free_list, &b->free_elem);
-
-          /* If the arena is now entirely unused, free it. */
-          if (++a->free_cnt >= d->blocks_per_arena) 
-            {
-              size_t i;
-
-              ASSERT (a->free_cnt == d->blocks_per_arena);
-              for (i = 0; i < d->blocks_per_arena; i++) 
-                {
-                  struct block *b = arena_to_block (a, i);
-                  list_remove (&b->free_elem);
-                }
-              palloc_free_page (a);
-            }
-
-          lock_release (&d->lock);
+          if ((size_t) (d - descs) < mag_desc_cnt)
+            magazine_put (d, b);
+          else
+            put_blocks (d, &b, 1);
         }
       else
         {
           /* It's a big block.  Free its pages. */
-          palloc_free_multiple (a, a->free_cnt);
+          free_arena_pages (a, a->free_cnt);
           return;
         }
     }
 }
 
+/* Makes A, D->arena_pages newly allocated pages, into an arena
+   for D and adds its blocks to D's free list.  D's lock must be
+   held. */
+static void
+add_arena (struct desc *d, struct arena *a) 
+{
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&d->lock));
+
+  /* Let blocks beyond the first page find the arena. */
+  for (i = 1; i < d->arena_pages; i++)
+    page_arenas[vtop (a) / PGSIZE + i] = a;
+
+  /* Initialize arena and add its blocks to the free list. */
+  a->magic = ARENA_MAGIC;
+  a->desc = d;
+  a->free_cnt = d->blocks_per_arena;
+  for (i = 0; i < d->blocks_per_arena; i++) 
+    {
+      struct block *b = arena_to_block (a, i);
+      list_push_back (&d->free_list, &b->free_elem);
+    }
+}
+
+/* Takes up to CNT blocks from D's free list, creating a new
+   arena first if the list is empty, and stores them in BLOCKS.
+   Returns the number of blocks taken, which is 0 only if memory
+   is not available. */
+static size_t
+take_blocks (struct desc *d, struct block *blocks[], size_t cnt) 
+{
+  size_t i;
+
+  lock_acquire (&d->lock);
+
+  /* If the free list is empty, create a new arena.  Its pages
+     are obtained without holding D's lock, because if the page
+     allocator runs out, malloc_reclaim() needs that lock. */
+  if (list_empty (&d->free_list))
+    {
+      struct arena *a;
+
+      lock_release (&d->lock);
+      a = get_arena_pages (d->arena_pages);
+      if (a == NULL)
+        return 0;
+      lock_acquire (&d->lock);
+      add_arena (d, a);
+    }
+
+  /* Get blocks from the free list. */
+  for (i = 0; i < cnt && !list_empty (&d->free_list); i++) 
+    {
+      struct block *b = list_entry (list_pop_front (&d->free_list),
+                                    struct block, free_elem);
+      block_to_arena (b)->free_cnt--;
+      blocks[i] = b;
+    }
+
+  lock_release (&d->lock);
+  return i;
+}
+
+/* Returns the CNT blocks in BLOCKS to D's free list, freeing any
+   arena that is left with no blocks in use. */
+static void
+put_blocks (struct desc *d, struct block *blocks[], size_t cnt) 
+{
+  size_t i, j;
+
+  lock_acquire (&d->lock);
+  for (i = 0; i < cnt; i++) 
+    {
+      struct block *b = blocks[i];
+      struct arena *a = block_to_arena (b);
+
+      /* Add block to free list. */
+      list_push_front (&d->free_list, &b->free_elem);
+
+      /* If the arena is now entirely unused, free it. */
+      if (++a->free_cnt >= d->blocks_per_arena) 
+        {
+          ASSERT (a->free_cnt == d->blocks_per_arena);
+          for (j = 0; j < d->blocks_per_arena; j++) 
+            {
+              struct block *b = arena_to_block (a, j);
+              list_remove (&b->free_elem);
+            }
+          for (j = 1; j < d->arena_pages; j++)
+            page_arenas[vtop (a) / PGSIZE + j] = NULL;
+          free_arena_pages (a, d->arena_pages);
+        }
+    }
+  lock_release (&d->lock);
+}
+
+/* Returns the magazine for D.  Interrupts must be off while the
+   caller uses it, to keep other threads out. */
+static struct magazine *
+desc_magazine (struct desc *d) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  return &magazines[d - descs];
+}
+
+/* Obtains a block from D by way of its magazine,
+   refilling the magazine if it is empty.  Returns a null pointer
+   if memory is not available. */
+static struct block *
+magazine_get (struct desc *d) 
+{
+  struct block *batch[MAG_BATCH];
+  struct magazine *m;
+  struct block *b = NULL;
+  enum intr_level old_level;
+  size_t cnt;
+
+  old_level = intr_disable ();
+  m = desc_magazine (d);
+  if (m->cnt > 0)
+    b = m->blocks[--m->cnt];
+  intr_set_level (old_level);
+  if (b != NULL)
+    return b;
+
+  /* The magazine is empty.  Refill it, keeping one block to
+     return. */
+  cnt = take_blocks (d, batch, MAG_BATCH);
+  if (cnt == 0)
+    return NULL;
+  b = batch[--cnt];
+
+  old_level = intr_disable ();
+  m = desc_magazine (d);
+  while (cnt > 0 && m->cnt < MAG_SIZE)
+    m->blocks[m->cnt++] = batch[--cnt];
+  intr_set_level (old_level);
+
+  /* Other threads may have filled the magazine while we were
+     waiting for the lock.  Put back the blocks that do not fit. */
+  if (cnt > 0)
+    put_blocks (d, batch, cnt);
+  return b;
+}
+
+/* Frees block B, from D, into its magazine,
+   draining the magazine first if it is full. */
+static void
+magazine_put (struct desc *d, struct block *b) 
+{
+  struct block *batch[MAG_BATCH];
+  struct magazine *m;
+  enum intr_level old_level;
+  size_t cnt = 0;
+
+  old_level = intr_disable ();
+  m = desc_magazine (d);
+  if (m->cnt >= MAG_SIZE)
+    {
+      /* Take out the oldest blocks, which are the least likely to
+         still be in the cache. */
+      cnt = MAG_BATCH;
+      memcpy (batch, m->blocks, sizeof batch);
+      memmove (m->blocks, m->blocks + MAG_BATCH,
+               (MAG_SIZE - MAG_BATCH) * sizeof *m->blocks);
+      m->cnt -= MAG_BATCH;
+    }
+  m->blocks[m->cnt++] = b;
+  intr_set_level (old_level);
+
+  if (cnt > 0)
+    put_blocks (d, batch, cnt);
+}
+
+/* Returns all the blocks in the magazines to their descriptors,
+   freeing any arena left with no blocks in use.  Returns true if
+   there were any.  Called by the page allocator when it runs
+   out of pages, so the caller must not hold any descriptor's
+   lock. */
+bool
+malloc_reclaim (void) 
+{
+  bool drained = false;
+  size_t i;
+
+  for (i = 0; i < mag_desc_cnt; i++) 
+    {
+      struct desc *d = &descs[i];
+      struct block *blocks[MAG_SIZE];
+      struct magazine *m;
+      enum intr_level old_level;
+      size_t cnt;
+
+      old_level = intr_disable ();
+      m = desc_magazine (d);
+      cnt = m->cnt;
+      memcpy (blocks, m->blocks, cnt * sizeof *blocks);
+      m->cnt = 0;
+      intr_set_level (old_level);
+
+      if (cnt > 0)
+        {
+          put_blocks (d, blocks, cnt);
+          drained = true;
+        }
+    }
+  return drained;
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b)
 {
-  struct arena *a = pg_round_down (b);
+  struct arena *a = page_arenas[vtop (b) / PGSIZE];
+
+  if (a == NULL)
+    a = pg_round_down (b);
 
   /* Check that the arena is valid. */
   ASSERT (a != NULL);
@@ -275,7 +597,7 @@ block_to_arena (struct block *b)
 
   /* Check that the block is properly aligned for the arena. */
   ASSERT (a->desc == NULL
-          || (pg_ofs (b) - sizeof *a) % a->desc->block_size == 0);
+          || ((uint8_t *) b - (uint8_t *) (a + 1)) % a->desc->block_size == 0);
   ASSERT (a->desc != NULL || pg_ofs (b) == sizeof *a);
 
   return a;
@@ -292,3 +614,42 @@ arena_to_block (struct arena *a, size_t idx)
                            + sizeof *a
                            + idx * a->desc->block_size);
 }
+
+/* Obtains PAGE_CNT contiguous pages for an arena and counts them
+   as part of the heap.  Returns a null pointer if memory is not
+   available. */
+static void *
+get_arena_pages (size_t page_cnt) 
+{
+  void *pages = palloc_get_multiple (0, page_cnt);
+
+  if (pages != NULL) 
+    {
+      enum intr_level old_level = intr_disable ();
+      heap_pages += page_cnt;
+      if (heap_pages > heap_pages_peak)
+        heap_pages_peak = heap_pages;
+      intr_set_level (old_level);
+    }
+  return pages;
+}
+
+/* Gives arena A, of PAGE_CNT pages, back to the page
+   allocator. */
+static void
+free_arena_pages (struct arena *a, size_t page_cnt) 
+{
+  enum intr_level old_level = intr_disable ();
+  heap_pages -= page_cnt;
+  intr_set_level (old_level);
+
+  palloc_free_multiple (a, page_cnt);
+}
+
+/* Prints heap statistics. */
+void
+malloc_print_stats (void) 
+{
+  printf ("Heap: %zu pages in use, %zu at peak\n",
+          heap_pages, heap_pages_peak);
+}
@@ -2,12 +2,14 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/loader.h"
+#include "threads/malloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
@@ -25,11 +27,41 @@
    half to the user pool.  That should be huge overkill for the
    kernel pool, but that's just fine for demonstration purposes. */
 
-/* A memory pool. */
+/* A memory pool.
+
+   Each pool is a binary buddy allocator.  Its free pages are kept
+   in blocks of 2**ORDER pages, aligned, relative to the pool's
+   base, on a multiple of their size, with one free list per
+   order.  An allocation takes a block of the smallest order that
+   is large enough, splitting a larger block if necessary, and
+   gives back the part of it that was not asked for.  Freeing a
+   block merges it with its "buddy", the other half of the block
+   of the next order up, for as long as that buddy is free too.
+   Thus both take O(log n) time, regardless of how full or
+   fragmented the pool is.
+
+   A request that is not a power of two is rounded up to the next
+   one, so it can fail for want of an aligned block even though
+   enough free pages lie side by side across smaller blocks.  In
+   that case alone the allocator falls back to scanning `used_map'
+   for a long enough run of free pages, which takes O(n) time, and
+   carves the run out of the blocks it overlaps.
+
+   The free lists are linked through the first bytes of the free
+   blocks themselves.  The order of each free block is recorded
+   in `orders', indexed by the block's first page, so that a free
+   block can find out whether its buddy is free.  `used_map'
+   tracks every page, to catch double frees. */
+#define ORDER_CNT 20                    /* Blocks of up to 2**19 pages. */
+#define ORDER_NONE 0xff                 /* Page does not start a free block. */
+
 struct pool
   {
     struct lock lock;                   /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
+    uint8_t *orders;                    /* Order of free block at each page. */
+    struct list free[ORDER_CNT];        /* Free blocks of each order. */
+    size_t page_cnt;                    /* Number of pages. */
     uint8_t *base;                      /* Base of pool. */
   };
 
@@ -39,6 +71,11 @@ static struct pool kernel_pool, user_pool;
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static size_t alloc_pages (struct pool *, size_t page_cnt);
+static size_t alloc_block (struct pool *, int order);
+static size_t alloc_range (struct pool *, size_t page_cnt);
+static void free_range (struct pool *, size_t page_idx, size_t page_cnt);
+static void free_block (struct pool *, size_t page_idx, int order);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -77,9 +114,12 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  /* If the kernel pool has run out, malloc() may be holding
+     free blocks, and maybe whole free arenas, in its caches.
+     Have it give them back and try again. */
+  page_idx = alloc_pages (pool, page_cnt);
+  if (page_idx == BITMAP_ERROR && pool == &kernel_pool && malloc_reclaim ())
+    page_idx = alloc_pages (pool, page_cnt);
 
   if (page_idx != BITMAP_ERROR)
     pages = pool->base + PGSIZE * page_idx;
@@ -137,8 +177,11 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
+  lock_acquire (&pool->lock);
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
   bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  free_range (pool, page_idx, page_cnt);
+  lock_release (&pool->lock);
 }
 
 /* Frees the page at PAGE. */
@@ -153,10 +196,13 @@ palloc_free_page (void *page)
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
+  /* We'll put the pool's used_map and orders at its base.
+     Calculate the space needed for them and subtract it from the
+     pool's size. */
+  size_t bm_size = bitmap_buf_size (page_cnt);
+  size_t bm_pages = DIV_ROUND_UP (bm_size + page_cnt, PGSIZE);
+  int order;
+
   if (bm_pages > page_cnt)
     PANIC ("Not enough memory in %s for bitmap.", name);
   page_cnt -= bm_pages;
@@ -165,8 +211,16 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
 
   /* Initialize the pool. */
   lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
+  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_size);
+  p->orders = (uint8_t *) base + bm_size;
+  memset (p->orders, ORDER_NONE, page_cnt);
+  for (order = 0; order < ORDER_CNT; order++)
+    list_init (&p->free[order]);
+  p->page_cnt = page_cnt;
   p->base = base + bm_pages * PGSIZE;
+
+  /* Put all of its pages on the free lists. */
+  free_range (p, 0, page_cnt);
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -176,7 +230,181 @@ page_from_pool (const struct pool *pool, void *page)
 {
   size_t page_no = pg_no (page);
   size_t start_page = pg_no (pool->base);
-  size_t end_page = start_page + bitmap_size (pool->used_map);
+  size_t end_page = start_page + pool->page_cnt;
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns the free list element stored in POOL's page PAGE_IDX. */
+static inline struct list_elem *
+block_elem (const struct pool *pool, size_t page_idx) 
+{
+  return (struct list_elem *) (pool->base + PGSIZE * page_idx);
+}
+
+/* Removes PAGE_CNT contiguous free pages from POOL and marks
+   them used, returning the index of the first, or BITMAP_ERROR
+   if there are not enough free pages. */
+static size_t
+alloc_pages (struct pool *pool, size_t page_cnt) 
+{
+  size_t page_idx = BITMAP_ERROR;
+  int order;
+
+  /* Find the smallest order that holds PAGE_CNT pages. */
+  for (order = 0; order < ORDER_CNT && ((size_t) 1 << order) < page_cnt;
+       order++)
+    continue;
+
+  lock_acquire (&pool->lock);
+  if (order < ORDER_CNT)
+    page_idx = alloc_block (pool, order);
+  if (page_idx != BITMAP_ERROR)
+    {
+      /* Give back the pages beyond PAGE_CNT. */
+      free_range (pool, page_idx + page_cnt, ((size_t) 1 << order) - page_cnt);
+    }
+  else
+    page_idx = alloc_range (pool, page_cnt);
+  if (page_idx != BITMAP_ERROR) 
+    {
+      ASSERT (bitmap_none (pool->used_map, page_idx, page_cnt));
+      bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+    }
+  lock_release (&pool->lock);
+  return page_idx;
+}
+
+/* Removes a free block of 2**ORDER pages from POOL, splitting a
+   larger one if necessary, and returns the index of its first
+   page, or BITMAP_ERROR if there is no block large enough.
+   POOL's lock must be held. */
+static size_t
+alloc_block (struct pool *pool, int order) 
+{
+  size_t page_idx;
+  int o;
+
+  for (o = order; o < ORDER_CNT; o++)
+    if (!list_empty (&pool->free[o]))
+      break;
+  if (o >= ORDER_CNT)
+    return BITMAP_ERROR;
+
+  page_idx = pg_no (list_pop_front (&pool->free[o])) - pg_no (pool->base);
+  pool->orders[page_idx] = ORDER_NONE;
+
+  /* Split it, putting the upper halves back, until it is the
+     right size. */
+  while (o > order) 
+    {
+      size_t upper;
+
+      o--;
+      upper = page_idx + ((size_t) 1 << o);
+      pool->orders[upper] = o;
+      list_push_front (&pool->free[o], block_elem (pool, upper));
+    }
+  return page_idx;
+}
+
+/* Returns the first page of the free block in POOL that contains
+   page PAGE_IDX, which must be free, and stores its order in
+   *ORDER.  Blocks are aligned on their size, so the block is the
+   one of some order O that starts at PAGE_IDX rounded down to a
+   multiple of 2**O. */
+static size_t
+find_free_block (const struct pool *pool, size_t page_idx, int *order) 
+{
+  int o;
+
+  for (o = 0; o < ORDER_CNT; o++) 
+    {
+      size_t first = page_idx & ~(((size_t) 1 << o) - 1);
+      if (pool->orders[first] == o) 
+        {
+          *order = o;
+          return first;
+        }
+    }
+  NOT_REACHED ();
+}
+
+/* Removes a run of PAGE_CNT free pages from POOL, wherever they
+   are and regardless of block boundaries, and returns the index
+   of its first page, or BITMAP_ERROR if there is no such run.
+   Each free block that the run overlaps is taken off its free
+   list, and the parts of it outside the run are put back.  Those
+   parts cannot merge into the run, because their buddies all lie
+   within the same block.  POOL's lock must be held. */
+static size_t
+alloc_range (struct pool *pool, size_t page_cnt) 
+{
+  size_t start = bitmap_scan (pool->used_map, 0, page_cnt, false);
+  size_t end, page_idx;
+
+  if (start == BITMAP_ERROR)
+    return BITMAP_ERROR;
+
+  end = start + page_cnt;
+  for (page_idx = start; page_idx < end; ) 
+    {
+      int order;
+      size_t first = find_free_block (pool, page_idx, &order);
+      size_t last = first + ((size_t) 1 << order);
+
+      list_remove (block_elem (pool, first));
+      pool->orders[first] = ORDER_NONE;
+      if (first < start)
+        free_range (pool, first, start - first);
+      if (last > end)
+        free_range (pool, end, last - end);
+      page_idx = last;
+    }
+  return start;
+}
+
+/* Returns the PAGE_CNT pages starting at PAGE_IDX to POOL's free
+   lists as the largest aligned blocks that make them up.  POOL's
+   lock must be held, except during initialization. */
+static void
+free_range (struct pool *pool, size_t page_idx, size_t page_cnt) 
+{
+  while (page_cnt > 0) 
+    {
+      int order = 0;
+
+      while (order + 1 < ORDER_CNT
+             && page_idx % ((size_t) 1 << (order + 1)) == 0
+             && ((size_t) 1 << (order + 1)) <= page_cnt)
+        order++;
+      free_block (pool, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Returns the block of 2**ORDER pages starting at PAGE_IDX to
+   POOL's free lists, merging it with its buddy for as long as
+   the buddy is free. */
+static void
+free_block (struct pool *pool, size_t page_idx, int order) 
+{
+  while (order + 1 < ORDER_CNT) 
+    {
+      size_t buddy = page_idx ^ ((size_t) 1 << order);
+
+      if (buddy + ((size_t) 1 << order) > pool->page_cnt
+          || pool->orders[buddy] != order)
+        break;
+
+      list_remove (block_elem (pool, buddy));
+      pool->orders[buddy] = ORDER_NONE;
+      if (buddy < page_idx)
+        page_idx = buddy;
+      order++;
+    }
+
+  pool->orders[page_idx] = order;
+  list_push_front (&pool->free[order], block_elem (pool, page_idx));
+}
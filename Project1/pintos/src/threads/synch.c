@@ -32,6 +32,15 @@
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
+/* Source of sequence numbers for waiters, which keep waiters of
+   equal priority in first-in, first-out order. */
+static unsigned next_wait_seq;
+
+static heap_less_func sema_less;
+static heap_less_func cond_less;
+static bool seq_after (unsigned a, unsigned b);
+static void lock_take (struct lock *);
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -47,7 +56,7 @@ sema_init (struct semaphore *sema, unsigned value)
   ASSERT (sema != NULL);
 
   sema->value = value;
-  list_init (&sema->waiters);
+  heap_init (&sema->waiters, sema_less, NULL);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -68,11 +77,11 @@ sema_down (struct semaphore *sema)
   old_level = intr_disable ();
   while (sema->value == 0) 
     {
-      //list_push_back (&sema->waiters, &thread_current ()->elem);
-      /* For priority scheduling synchronization */
-      /* Put the therad in waiters using priority method */
-      list_insert_ordered(&sema->waiters, &thread_current()->elem, 
-                          sema_compare_priority, NULL);
+      struct thread *cur = thread_current ();
+
+      cur->wait_seq = next_wait_seq++;
+      cur->wait_sema = sema;
+      heap_push (&sema->waiters, &cur->waitelem);
       thread_block ();
     }
   sema->value--;
@@ -106,29 +115,37 @@ sema_try_down (struct semaphore *sema)
 }
 
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
-   and wakes up one thread of those waiting for SEMA, if any.
+   and wakes up the highest-priority thread of those waiting for
+   SEMA, if any.  If that thread has a higher priority than the
+   running thread, yields to it, or, in an interrupt handler,
+   yields to it as soon as the handler returns.
 
    This function may be called from an interrupt handler. */
 void
 sema_up (struct semaphore *sema) 
 {
   enum intr_level old_level;
+  struct thread *t = NULL;
 
   ASSERT (sema != NULL);
 
   old_level = intr_disable ();
-  if (!list_empty(&sema->waiters))
-  { 
-    /* For priority scheduling synchronization */
-    /* Sort waiters list according to priority */
-    list_sort(&sema->waiters,sema_compare_priority, NULL); 
-    thread_unblock (list_entry (list_pop_front (&sema->waiters),
-                                struct thread, elem));
-  }
+  if (!heap_empty (&sema->waiters)) 
+    {
+      t = heap_entry (heap_pop (&sema->waiters), struct thread, waitelem);
+      t->wait_sema = NULL;
+      thread_unblock (t);
+    }
   sema->value++;
-  /* Execute priority preemption */
-  thread_yield();
 
+  /* Execute priority preemption */
+  if (t != NULL && t->priority > thread_current ()->priority) 
+    {
+      if (intr_context ())
+        intr_yield_on_return ();
+      else
+        thread_yield ();
+    }
   intr_set_level (old_level);
 }
 
@@ -191,6 +208,7 @@ lock_init (struct lock *lock)
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+  lock->max_priority = PRI_MIN - 1;
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -204,11 +222,13 @@ lock_init (struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
+  enum intr_level old_level;
 
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
   /* For priority-donation & 4BSD scheduler */
   /* When not an advance scheduler and 
      the holder of the lock exists */
@@ -216,12 +236,6 @@ lock_acquire (struct lock *lock)
   {
     /* Store lock in wait_lock of current thread */
     thread_current()->wait_lock = lock;
-    /* Store the priority of current thread 
-       in the initial priority of current thread */
-    thread_current()->init_priority = thread_current()->priority;
-    /* Add current thread to donation list of holder thread */
-    list_insert_ordered(&lock->holder->donation, &thread_current()->elem_donation, 
-                        compare_priority, NULL);
     /* Execute priority donation */
     priority_donate();
   }
@@ -229,7 +243,8 @@ lock_acquire (struct lock *lock)
   sema_down (&lock->semaphore);
   // Added part for priority-donation
   thread_current()->wait_lock = NULL;
-  lock->holder = thread_current ();
+  lock_take (lock);
+  intr_set_level (old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -241,14 +256,17 @@ lock_acquire (struct lock *lock)
 bool
 lock_try_acquire (struct lock *lock)
 {
+  enum intr_level old_level;
   bool success;
 
   ASSERT (lock != NULL);
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    lock_take (lock);
+  intr_set_level (old_level);
   return success;
 }
 
@@ -260,21 +278,21 @@ lock_try_acquire (struct lock *lock)
 void
 lock_release (struct lock *lock) 
 {
+  enum intr_level old_level;
 
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
+  list_remove (&lock->elem);
   /* For priority-donation & 4BSD scheduler */
   /* When not an advance scheduler */
   if(!thread_mlfqs)
-  {
-    /* Execute remove_lock function */
-    remove_lock(lock);
-    /* Execute recover_priority function */
+    /* Drop what this lock's waiters donated */
     recover_priority();
-  }
   lock->holder = NULL;
   sema_up (&lock->semaphore);
+  intr_set_level (old_level);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -288,11 +306,37 @@ lock_held_by_current_thread (const struct lock *lock)
   return lock->holder == thread_current ();
 }
 
-/* One semaphore in a list. */
+/* Makes the current thread the holder of LOCK, which it has just
+   downed the semaphore of.  Caches the priority of the highest
+   waiter left behind, which the new holder then inherits, and
+   adds LOCK to the holder's held locks.  Must be called with
+   interrupts off. */
+static void
+lock_take (struct lock *lock) 
+{
+  struct thread *cur = thread_current ();
+  struct heap *waiters = &lock->semaphore.waiters;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  lock->holder = cur;
+  lock->max_priority = PRI_MIN - 1;
+  if (!heap_empty (waiters))
+    lock->max_priority = heap_entry (heap_top (waiters),
+                                     struct thread, waitelem)->priority;
+  list_push_back (&cur->held_locks, &lock->elem);
+
+  if (!thread_mlfqs && lock->max_priority > cur->priority)
+    recover_priority ();
+}
+
+/* One semaphore in a condition's waiters heap. */
 struct semaphore_elem 
   {
-    struct list_elem elem;              /* List element. */
+    struct heap_elem elem;              /* Heap element. */
     struct semaphore semaphore;         /* This semaphore. */
+    struct thread *thread;              /* Thread waiting on it. */
+    unsigned seq;                       /* Orders equal-priority waiters. */
   };
 
 /* Initializes condition variable COND.  A condition variable
@@ -303,7 +347,7 @@ cond_init (struct condition *cond)
 {
   ASSERT (cond != NULL);
 
-  list_init (&cond->waiters);
+  heap_init (&cond->waiters, cond_less, NULL);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -329,7 +373,9 @@ cond_init (struct condition *cond)
 void
 cond_wait (struct condition *cond, struct lock *lock) 
 {
+  struct thread *cur = thread_current ();
   struct semaphore_elem waiter;
+  enum intr_level old_level;
 
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
@@ -337,12 +383,17 @@ cond_wait (struct condition *cond, struct lock *lock)
   ASSERT (lock_held_by_current_thread (lock));
   
   sema_init (&waiter.semaphore, 0);
-  //list_push_back (&cond->waiters, &waiter.elem);
-  /* For priority scheduling synchronization */
-  /* Put the therad in waiters according to priority */
-  list_insert_ordered(&cond->waiters, &waiter.elem, 
-                      cond_compare_priority, NULL);
-  
+  waiter.thread = cur;
+
+  /* Donation may reorder COND's waiters without holding LOCK, so
+     they are changed only with interrupts off. */
+  old_level = intr_disable ();
+  waiter.seq = next_wait_seq++;
+  cur->wait_cond = cond;
+  cur->cond_elem = &waiter.elem;
+  heap_push (&cond->waiters, &waiter.elem);
+  intr_set_level (old_level);
+
   lock_release (lock);
   sema_down (&waiter.semaphore);
   lock_acquire (lock);
@@ -363,14 +414,19 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED)
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
 
-  if (!list_empty (&cond->waiters)) 
-  {
-    /* For priority scheduling synchronization */
-    /* Sort waiters list according to priority */
-    list_sort(&cond->waiters,cond_compare_priority, NULL);
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
-  }
+  if (!heap_empty (&cond->waiters)) 
+    {
+      struct semaphore_elem *waiter;
+      enum intr_level old_level;
+
+      old_level = intr_disable ();
+      waiter = heap_entry (heap_pop (&cond->waiters),
+                           struct semaphore_elem, elem);
+      waiter->thread->wait_cond = NULL;
+      intr_set_level (old_level);
+
+      sema_up (&waiter->semaphore);
+    }
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -385,41 +441,297 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
 
-  while (!list_empty (&cond->waiters))
+  while (!heap_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
 
-/* Added function */
-/* For priority scheduling synchronization */
-/* Compare the priority between two threads in waiter list of semaphore */
+/* Initializes RWLOCK.  A readers-writer lock may be held by any
+   number of readers at once, or by a single writer.
+
+   A writer holds RWLOCK's inner lock for as long as it writes,
+   and a reader holds it just long enough to count itself in, so
+   every thread that has to wait for a writer waits on a lock
+   held by that writer and donates its priority to it in the
+   usual way.  Waiting readers and writers are admitted in the
+   order of the inner lock's wait queue, that is, by priority and
+   then in arrival order.  Once a writer is waiting, no new
+   reader gets in ahead of it, so a stream of readers cannot
+   starve writers.
+
+   A writer waiting for the readers already inside to leave
+   donates its priority to them, so that a low-priority reader
+   cannot hold up a high-priority writer indefinitely.  For that
+   each reader records its hold in one of its thread's
+   READ_HOLD_MAX `read_holds' slots, which are linked into
+   RWLOCK's reader_list.  A thread reading more locks than
+   that at once gets no donation for the extra ones.
+
+   Like locks, readers-writer locks are not recursive: a thread
+   that holds RWLOCK for reading must not acquire it for reading
+   again, because it would deadlock if a writer arrived in
+   between. */
+void
+rwlock_init (struct rwlock *rwlock) 
+{
+  ASSERT (rwlock != NULL);
+
+  lock_init (&rwlock->lock);
+  rwlock->readers = 0;
+  rwlock->draining = false;
+  sema_init (&rwlock->drained, 0);
+  list_init (&rwlock->reader_list);
+  rwlock->max_priority = PRI_MIN - 1;
+}
+
+/* Acquires RWLOCK for reading, sleeping until no writer holds or
+   is waiting for it if necessary.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rwlock) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int i;
+
+  ASSERT (rwlock != NULL);
+  ASSERT (!intr_context ());
+
+  lock_acquire (&rwlock->lock);
+  old_level = intr_disable ();
+  rwlock->readers++;
+  for (i = 0; i < READ_HOLD_MAX; i++)
+    if (cur->read_holds[i].rwlock == NULL) 
+      {
+        cur->read_holds[i].rwlock = rwlock;
+        list_push_back (&rwlock->reader_list, &cur->read_holds[i].elem);
+        break;
+      }
+  intr_set_level (old_level);
+  lock_release (&rwlock->lock);
+}
+
+/* Releases RWLOCK, which the current thread must hold for
+   reading.  If this is the last reader and a writer is waiting,
+   lets the writer in. */
+void
+rwlock_release_read (struct rwlock *rwlock) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int i;
+
+  ASSERT (rwlock != NULL);
+
+  old_level = intr_disable ();
+  ASSERT (rwlock->readers > 0);
+  for (i = 0; i < READ_HOLD_MAX; i++)
+    if (cur->read_holds[i].rwlock == rwlock) 
+      {
+        list_remove (&cur->read_holds[i].elem);
+        cur->read_holds[i].rwlock = NULL;
+        /* Drop what a waiting writer donated */
+        if (!thread_mlfqs && rwlock->max_priority > cur->init_priority)
+          recover_priority ();
+        break;
+      }
+  if (--rwlock->readers == 0 && rwlock->draining)
+    {
+      rwlock->draining = false;
+      sema_up (&rwlock->drained);
+    }
+  intr_set_level (old_level);
+}
+
+/* Acquires RWLOCK for writing, sleeping until no other thread
+   holds it if necessary.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rwlock) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rwlock != NULL);
+  ASSERT (!intr_context ());
+
+  /* Holding the inner lock keeps new readers out. */
+  lock_acquire (&rwlock->lock);
+
+  /* Wait for the readers already inside to leave, lending them
+     our priority meanwhile. */
+  old_level = intr_disable ();
+  if (rwlock->readers > 0) 
+    {
+      struct thread *cur = thread_current ();
+
+      rwlock->draining = true;
+      if (!thread_mlfqs) 
+        {
+          cur->wait_rwlock = rwlock;
+          priority_donate ();
+        }
+      sema_down (&rwlock->drained);
+      cur->wait_rwlock = NULL;
+      rwlock->max_priority = PRI_MIN - 1;
+    }
+  intr_set_level (old_level);
+}
+
+/* Releases RWLOCK, which the current thread must hold for
+   writing. */
+void
+rwlock_release_write (struct rwlock *rwlock) 
+{
+  ASSERT (rwlock != NULL);
+  ASSERT (rwlock->readers == 0);
+
+  lock_release (&rwlock->lock);
+}
+
+/* Returns true if the current thread holds RWLOCK for writing,
+   false otherwise. */
 bool
-sema_compare_priority(const struct list_elem *a,
-                      const struct list_elem *b, void* aux)
-{ 
-  /* Return the two threads as struct thread */
-  struct thread *t_a = list_entry(a, struct thread, elem);
-  struct thread *t_b = list_entry(b, struct thread, elem);
-  /* Compare the priority */
-  if (t_a->priority > t_b->priority)
-    return true;
-  else return false;
+rwlock_held_for_write (const struct rwlock *rwlock) 
+{
+  ASSERT (rwlock != NULL);
+
+  return lock_held_by_current_thread (&rwlock->lock);
+}
+
+/* Initializes SEQLOCK.  A sequence lock protects a small amount
+   of data that is read much more often than it is written, such
+   as a 64-bit counter that cannot be read in one instruction.
+
+   Readers take no lock and never make a writer wait.  Instead, a
+   reader reads the sequence number, copies the data, and then
+   checks that the sequence number is even and has not changed,
+   retrying otherwise:
+
+     unsigned seq;
+     do 
+       {
+         seq = seqlock_read_begin (&seqlock);
+         copy = data;
+       }
+     while (seqlock_read_retry (&seqlock, seq));
+
+   Writers bracket their updates with seqlock_write_begin() and
+   seqlock_write_end(), which make the sequence number odd while
+   the update is in progress.  Writers exclude each other by
+   turning interrupts off, so they may be interrupt handlers.
+   For the same reason a reader must not run in an interrupt
+   handler that might have interrupted a writer, because it would
+   retry forever. */
+void
+seqlock_init (struct seqlock *seqlock) 
+{
+  ASSERT (seqlock != NULL);
+
+  seqlock->seq = 0;
 }
-/* Compare the priority between two threads in waiter list of condition */
+
+/* Begins a read of the data protected by SEQLOCK, returning the
+   sequence number to pass to seqlock_read_retry(). */
+unsigned
+seqlock_read_begin (const struct seqlock *seqlock) 
+{
+  unsigned seq;
+
+  ASSERT (seqlock != NULL);
+
+  /* Wait for any write in progress to finish. */
+  while ((seq = seqlock->seq) & 1)
+    continue;
+  barrier ();
+  return seq;
+}
+
+/* Returns true if the data read since the seqlock_read_begin()
+   call that returned SEQ may be inconsistent, so that the read
+   must be retried, false if it is good. */
 bool
-cond_compare_priority(const struct list_elem *a,
-                      const struct list_elem *b, void* aux)
-{ 
-  /* Return the two semaphore_elem as struct semaphore_elem */
-  struct semaphore_elem *e_a = list_entry(a, struct semaphore_elem, elem);
-  struct semaphore_elem *e_b = list_entry(b, struct semaphore_elem, elem);
-  /* Return the two list_elem as struct list_elem */
-  struct list_elem *le_a = list_begin(&e_a->semaphore.waiters);
-  struct list_elem *le_b = list_begin(&e_b->semaphore.waiters);
-  /* Return the two threads as struct thread */
-  struct thread *t_a = list_entry(le_a, struct thread, elem);
-  struct thread *t_b = list_entry(le_b, struct thread, elem);
-  /* Compare the priority */
-  if (t_a->priority > t_b->priority)
-    return true;
-  else return false;
+seqlock_read_retry (const struct seqlock *seqlock, unsigned seq) 
+{
+  ASSERT (seqlock != NULL);
+
+  barrier ();
+  return seqlock->seq != seq;
+}
+
+/* Begins an update of the data protected by SEQLOCK.  Interrupts
+   are off until the matching seqlock_write_end(). */
+void
+seqlock_write_begin (struct seqlock *seqlock) 
+{
+  ASSERT (seqlock != NULL);
+
+  seqlock->old_level = intr_disable ();
+  seqlock->seq++;
+  barrier ();
+}
+
+/* Ends an update of the data protected by SEQLOCK. */
+void
+seqlock_write_end (struct seqlock *seqlock) 
+{
+  ASSERT (seqlock != NULL);
+
+  barrier ();
+  seqlock->seq++;
+  intr_set_level (seqlock->old_level);
+}
+
+/* Restores the order of the waiters that T is among, if any,
+   after T's priority has changed.  Must be called with
+   interrupts off. */
+void
+synch_reprioritize (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->wait_sema != NULL)
+    heap_update (&t->wait_sema->waiters, &t->waitelem);
+  if (t->wait_cond != NULL)
+    heap_update (&t->wait_cond->waiters, t->cond_elem);
+}
+
+/* Returns true if sequence number A was handed out after B. */
+static bool
+seq_after (unsigned a, unsigned b) 
+{
+  return (int) (a - b) > 0;
+}
+
+/* Orders semaphore waiters by priority, and those of equal
+   priority by arrival, first come first. */
+static bool
+sema_less (const struct heap_elem *a_, const struct heap_elem *b_,
+           void *aux UNUSED) 
+{
+  const struct thread *a = heap_entry (a_, struct thread, waitelem);
+  const struct thread *b = heap_entry (b_, struct thread, waitelem);
+
+  if (a->priority != b->priority)
+    return a->priority < b->priority;
+  return seq_after (a->wait_seq, b->wait_seq);
+}
+
+/* Orders condition waiters by the priority of the waiting
+   thread, and those of equal priority by arrival, first come
+   first. */
+static bool
+cond_less (const struct heap_elem *a_, const struct heap_elem *b_,
+           void *aux UNUSED) 
+{
+  const struct semaphore_elem *a
+    = heap_entry (a_, struct semaphore_elem, elem);
+  const struct semaphore_elem *b
+    = heap_entry (b_, struct semaphore_elem, elem);
+
+  if (a->thread->priority != b->thread->priority)
+    return a->thread->priority < b->thread->priority;
+  return seq_after (a->seq, b->seq);
 }
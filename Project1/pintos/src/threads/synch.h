@@ -1,14 +1,18 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
+#include "threads/interrupt.h"
+
+struct thread;
 
 /* A counting semaphore. */
 struct semaphore 
   {
     unsigned value;             /* Current value. */
-    struct list waiters;        /* List of waiting threads. */
+    struct heap waiters;        /* Waiting threads, by priority. */
   };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -22,6 +26,8 @@ struct lock
   {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+    struct list_elem elem;      /* Element in holder's held_locks. */
+    int max_priority;           /* Highest waiter priority, or PRI_MIN - 1. */
   };
 
 void lock_init (struct lock *);
@@ -33,7 +39,7 @@ bool lock_held_by_current_thread (const struct lock *);
 /* Condition variable. */
 struct condition 
   {
-    struct list waiters;        /* List of waiting threads. */
+    struct heap waiters;        /* Waiting threads, by priority. */
   };
 
 void cond_init (struct condition *);
@@ -41,13 +47,38 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+void synch_reprioritize (struct thread *);
+
+/* Readers-writer lock. */
+struct rwlock 
+  {
+    struct lock lock;           /* Held by the writer, if any. */
+    unsigned readers;           /* Number of threads reading. */
+    bool draining;              /* Writer waiting for readers to leave? */
+    struct semaphore drained;   /* Up'd by the last reader to leave. */
+    struct list reader_list;    /* Tracked readers' `struct read_hold's. */
+    int max_priority;           /* Priority of the draining writer. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
+
+/* Sequence lock. */
+struct seqlock 
+  {
+    volatile unsigned seq;      /* Odd while a write is in progress. */
+    enum intr_level old_level;  /* Writer's interrupt level. */
+  };
 
-// Added function
-// For priority scheduling and synchronization
-bool sema_compare_priority(const struct list_elem *a,
-                           const struct list_elem *b, void* aux);
-bool cond_compare_priority(const struct list_elem *a,
-                           const struct list_elem *b, void* aux);
+void seqlock_init (struct seqlock *);
+unsigned seqlock_read_begin (const struct seqlock *);
+bool seqlock_read_retry (const struct seqlock *, unsigned seq);
+void seqlock_write_begin (struct seqlock *);
+void seqlock_write_end (struct seqlock *);
 
 /* Optimization barrier.
 
@@ -11,6 +11,7 @@
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 
 /* Added Headerfile */
 /* For 4BSD scheduler */
@@ -26,17 +27,29 @@
 #define THREAD_MAGIC 0xcd6abf4b
 
 /* Added variables */
-/* For Alarm clock */
-/* Store the smallest wakeup value among threads in sleep list */
-static int64_t next_wakeup = INT64_MAX;  
-/* List to manage THREAD_BLOCKED threads */
-static struct list sleep_list;
 /* For 4BSD scheduler */
 int load_avg;          /* Declaer load_avg */
-
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Number of once-a-second recent_cpu decays so far.  Only the
+   running thread is decayed every second.  Each other thread's
+   cpu_second says how far it has got: a blocked thread catches
+   up when it is unblocked, and a ready thread when its run queue
+   is next looked at by the scheduler. */
+static int64_t bsd_seconds;
+
+/* Run queue of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+   There is one FIFO list per priority, and bit P of ready_mask
+   is set if and only if ready_queues[P] is nonempty, so the
+   highest-priority ready thread can be found in constant
+   time. */
+static struct list ready_queues[PRI_MAX + 1];
+static uint64_t ready_mask;
+static int ready_cnt;           /* Number of ready threads. */
+
+/* Bit P is set if ready_queues[P] may hold threads that have
+   missed some of the once-a-second recalculations, which
+   next_thread_to_run() applies before it chooses. */
+static uint64_t ready_stale_mask;
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
@@ -48,6 +61,19 @@ static struct thread *idle_thread;
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
+/* Cache of pages freed by exiting threads, for reuse by
+   thread_create() without a trip through the page allocator or
+   zeroing the page again.  The pages are kept in a stack, so the
+   most recently freed one, which is the most likely to still be
+   in the CPU cache, is reused first. */
+#define THREAD_CACHE_MAX 16     /* Maximum number of cached pages. */
+static void *thread_cache[THREAD_CACHE_MAX];
+static size_t thread_cache_cnt;
+
+/* If true (default), recycle the pages of exiting threads.
+   If false, free them and allocate new ones each time. */
+bool thread_cache_enabled = true;
+
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
@@ -84,6 +110,16 @@ static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static struct thread *thread_page_get (void);
+static void thread_page_put (struct thread *);
+static void ready_push (struct thread *);
+static void ready_remove (struct thread *);
+static int ready_max_priority (void);
+static void ready_catch_up (void);
+static void set_priority (struct thread *, int priority);
+static timer_event_func thread_wake;
+static void donate_chain (struct thread *, int priority, int depth);
+static void bsd_catch_up (struct thread *);
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
@@ -101,12 +137,14 @@ static tid_t allocate_tid (void);
 void
 thread_init (void) 
 {
+  int i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
-  list_init (&ready_list);
+  for (i = PRI_MIN; i <= PRI_MAX; i++)
+    list_init (&ready_queues[i]);
   list_init (&all_list);
-  list_init (&sleep_list);     // Initialize sleep_list
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
@@ -156,6 +194,14 @@ thread_tick (void)
     intr_yield_on_return ();
 }
 
+/* Called by the timer interrupt handler for each tick that passed
+   while the CPU was idle in tickless mode. */
+void
+thread_idle_tick (void) 
+{
+  idle_ticks++;
+}
+
 /* Prints thread statistics. */
 void
 thread_print_stats (void) 
@@ -193,7 +239,7 @@ thread_create (const char *name, int priority,
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = thread_page_get ();
   if (t == NULL)
     return TID_ERROR;
 
@@ -266,11 +312,10 @@ thread_unblock (struct thread *t)
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  // list_push_back (&ready_list, &t->elem);
-  /* For priority scheduling */ 
-  /* Put the therad in ready_list using priority method */
-  list_insert_ordered(&ready_list, &t->elem, compare_priority, NULL);
+  if (thread_mlfqs)
+    bsd_catch_up (t);
   t->status = THREAD_READY;
+  ready_push (t);
   intr_set_level (old_level);
 }
 
@@ -339,12 +384,9 @@ thread_yield (void)
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
-  if (cur != idle_thread) 
-    // list_push_back (&ready_list, &cur->elem);
-    /* For priority scheduling */
-    /* Put the therad in ready_list using priority method */
-    list_insert_ordered(&ready_list, &cur->elem, compare_priority, NULL);
   cur->status = THREAD_READY;
+  if (cur != idle_thread) 
+    ready_push (cur);
   schedule ();
   intr_set_level (old_level);
 }
@@ -373,7 +415,7 @@ thread_set_priority (int new_priority)
   /* For 4BSD scheduler */
   if(!thread_mlfqs)             /* When not an advance scheduler */
   {
-    thread_current()->priority = new_priority;
+    set_priority (thread_current (), new_priority);
     /* For priority donation */
     /* Store input value in init_priority */
     thread_current()->init_priority = new_priority;
@@ -492,7 +534,12 @@ idle (void *idle_started_ UNUSED)
          time.
 
          See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
-         7.11.1 "HLT Instruction". */
+         7.11.1 "HLT Instruction".
+
+         In tickless mode, the next interrupt may not come until
+         the timer next has work to do.  The tickless period ends
+         in schedule() when another thread is chosen to run. */
+      timer_idle_enter ();
       asm volatile ("sti; hlt" : : : "memory");
     }
 }
@@ -530,30 +577,84 @@ is_thread (struct thread *t)
 }
 
 /* Does basic initialization of T as a blocked thread named
-   NAME. */
+   NAME.  T's page is not zeroed first, since it may have been
+   recycled from an exited thread, so every member that is read
+   before it is written must be set here. */
 static void
 init_thread (struct thread *t, const char *name, int priority)
 {
+  int i;
+
   ASSERT (t != NULL);
   ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
   ASSERT (name != NULL);
 
-  memset (t, 0, sizeof *t);
+  t->tid = TID_ERROR;
   t->status = THREAD_BLOCKED;
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
   t->priority = priority;
+#ifdef USERPROG
+  t->pagedir = NULL;
+#endif
   t->magic = THREAD_MAGIC;
   list_push_back (&all_list, &t->allelem);
 
   /* Added initialize of value */
   /* For priority-donation */
   t->init_priority = priority;   /* Initialize the init_priority */
-  lock_init (&t->wait_lock);     /* Initialize the wait_lock */
-  list_init (&t->donation);      /* Initialize the donation list */
+  t->wait_lock = NULL;           /* Initialize the wait_lock */
+  t->wait_sema = NULL;
+  t->wait_cond = NULL;
+  t->wait_rwlock = NULL;
+  for (i = 0; i < READ_HOLD_MAX; i++) 
+    {
+      t->read_holds[i].rwlock = NULL;
+      t->read_holds[i].thread = t;
+    }
+  list_init (&t->held_locks);    /* Initialize the held locks list */
   /* For 4BSD scheduler */
   t->nice = NICE_DEFAULT;        /* Initialize the nice value */
   t->recent_cpu = RECENT_CPU_DEFAULT;  /* Initialize the recnet cpu value */
+  t->cpu_second = bsd_seconds;
+}
+
+/* Returns a page for a new thread, from the thread page cache
+   if possible, otherwise from the page allocator, or a null
+   pointer if no page is available.  With the cache enabled the
+   page's contents are undefined; with it disabled the page is
+   zeroed, as it was before there was a cache. */
+static struct thread *
+thread_page_get (void) 
+{
+  void *page = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (thread_cache_enabled && thread_cache_cnt > 0)
+    page = thread_cache[--thread_cache_cnt];
+  intr_set_level (old_level);
+
+  if (page == NULL)
+    page = palloc_get_page (thread_cache_enabled ? 0 : PAL_ZERO);
+  return page;
+}
+
+/* Releases the page of dead thread T, keeping it in the thread
+   page cache if there is room. */
+static void
+thread_page_put (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (thread_cache_enabled && thread_cache_cnt < THREAD_CACHE_MAX)
+    {
+      thread_cache[thread_cache_cnt++] = t;
+      t = NULL;
+    }
+
+  if (t != NULL)
+    palloc_free_page (t);
 }
 
 /* Allocates a SIZE-byte frame at the top of thread T's stack and
@@ -577,10 +678,134 @@ alloc_frame (struct thread *t, size_t size)
 static struct thread *
 next_thread_to_run (void) 
 {
-  if (list_empty (&ready_list))
+  struct thread *t;
+  int priority;
+
+  if (ready_stale_mask != 0)
+    ready_catch_up ();
+
+  priority = ready_max_priority ();
+  if (priority < PRI_MIN)
     return idle_thread;
+
+  t = list_entry (list_front (&ready_queues[priority]), struct thread, elem);
+  ready_remove (t);
+  return t;
+}
+
+/* Adds T, which must be ready, to the back of the run queue for
+   its priority. */
+static void
+ready_push (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_READY);
+  ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+  list_push_back (&ready_queues[t->priority], &t->elem);
+  ready_mask |= (uint64_t) 1 << t->priority;
+  if (thread_mlfqs && t->cpu_second < bsd_seconds)
+    ready_stale_mask |= (uint64_t) 1 << t->priority;
+  ready_cnt++;
+}
+
+/* Removes T from the run queue. */
+static void
+ready_remove (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  list_remove (&t->elem);
+  if (list_empty (&ready_queues[t->priority])) 
+    {
+      ready_mask &= ~((uint64_t) 1 << t->priority);
+      ready_stale_mask &= ~((uint64_t) 1 << t->priority);
+    }
+  ready_cnt--;
+}
+
+/* Returns the priority of the highest-priority ready thread, or
+   PRI_MIN - 1 if no thread is ready. */
+static int
+ready_max_priority (void) 
+{
+  uint32_t hi = ready_mask >> 32;
+  uint32_t lo = ready_mask;
+
+  if (hi != 0)
+    return 63 - __builtin_clz (hi);
+  else if (lo != 0)
+    return 31 - __builtin_clz (lo);
   else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+    return PRI_MIN - 1;
+}
+
+/* Brings every thread in a stale run queue up to date with the
+   once-a-second recalculations it missed, moving it to the run
+   queue for its new priority.  The queues are done highest
+   priority first, keeping FIFO order within each one. */
+static void
+ready_catch_up (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (ready_stale_mask != 0) 
+    {
+      uint32_t hi = ready_stale_mask >> 32;
+      int priority = (hi != 0 ? 63 - __builtin_clz (hi)
+                      : 31 - __builtin_clz ((uint32_t) ready_stale_mask));
+      struct list *q = &ready_queues[priority];
+      struct list stale;
+
+      list_init (&stale);
+      list_splice (list_end (&stale), list_begin (q), list_end (q));
+      ready_mask &= ~((uint64_t) 1 << priority);
+      ready_stale_mask &= ~((uint64_t) 1 << priority);
+
+      /* Each thread is marked blocked while it is out of the run
+         queue, so that set_priority() does not try to requeue
+         it. */
+      while (!list_empty (&stale)) 
+        {
+          struct thread *t = list_entry (list_pop_front (&stale),
+                                         struct thread, elem);
+          ready_cnt--;
+          t->status = THREAD_BLOCKED;
+          bsd_catch_up (t);
+          t->status = THREAD_READY;
+          ready_push (t);
+        }
+    }
+}
+
+/* Changes T's priority to PRIORITY, moving T to the matching run
+   queue if it is ready, or to its new place among the waiters
+   for a semaphore or condition if it is waiting for one. */
+static void
+set_priority (struct thread *t, int priority) 
+{
+  enum intr_level old_level;
+
+  if (priority < PRI_MIN)
+    priority = PRI_MIN;
+  else if (priority > PRI_MAX)
+    priority = PRI_MAX;
+  if (t->priority == priority)
+    return;
+
+  old_level = intr_disable ();
+  if (t->status == THREAD_READY && t != idle_thread) 
+    {
+      ready_remove (t);
+      t->priority = priority;
+      ready_push (t);
+    }
+  else 
+    {
+      t->priority = priority;
+      synch_reprioritize (t);
+    }
+  intr_set_level (old_level);
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -625,7 +850,7 @@ thread_schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      thread_page_put (prev);
     }
 }
 
@@ -648,7 +873,12 @@ schedule (void)
   ASSERT (is_thread (next));
 
   if (cur != next)
-    prev = switch_threads (cur, next);
+    {
+      /* Bring the timer out of tickless idle, if it is in it. */
+      if (cur == idle_thread)
+        timer_idle_exit ();
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev);
 }
 
@@ -668,174 +898,153 @@ allocate_tid (void)
 
 /* Added Function */
 /* For Alarm clock */
-/* Make running thread to THREAD_BLOCKED state 
-   and add it to the sleep list */
+/* Make running thread to THREAD_BLOCKED state until tick TICKS.
+   The wakeup is a timer event that lives on the sleeping
+   thread's stack, so sleeping costs no allocation and waking
+   costs no search. */
 void
 thread_sleep(int64_t ticks)
 {
-  /* Disables interrupts */
-  enum intr_level old_level;    
-  old_level = intr_disable();      
-  /* Stores running thread to *t variable */
-  struct thread *t = thread_current();
-  /* When running thread is not idle_thread */
-  if(t != idle_thread)    
-  {
-    /* Save input argument to wakeup variable of thread */
-    t->wakeup = ticks;
-    /* Update next_wakup value */
-    update_wakeup(t->wakeup);
-    /* Add running thread to the sleep list */
-    list_push_back(&sleep_list,&t->elem);
-    /* Make running thread to THREAD_BLOCKED state and schedule */
-    thread_block();
-  }
-  /* Returns the previous interrput status */
-  intr_set_level(old_level);       
-}
-/* Compare the existing next_wakeup value with the input value
-   and store the smaller value in the next_wakeup variable */
-void
-update_wakeup(int64_t ticks)
-{
-  if(next_wakeup > ticks)
-    next_wakeup = ticks;
-}
-/* Return next_wakeup value */
-int64_t
-return_wakeup(void)
-{
-  return next_wakeup;
+  struct thread *t = thread_current ();
+  struct timer_event alarm;
+  enum intr_level old_level;
+
+  /* The idle thread must never block here */
+  if (t == idle_thread)
+    return;
+
+  timer_event_init (&alarm, thread_wake, t);
+  old_level = intr_disable ();
+  timer_event_add (&alarm, ticks);
+  thread_block ();
+  intr_set_level (old_level);
 }
-/* Wake up a thread that is asleep in the sleep list */
-void
-thread_awake(int64_t ticks)
+/* Timer event function that wakes up sleeping thread T_.  Runs
+   in the timer interrupt, so a higher-priority sleeper preempts
+   the running thread as soon as the interrupt returns. */
+static void
+thread_wake (void *t_)
 {
-  struct list_elem *wake_e;
-  /* Search sleep list for find thread to wake up */
-  for(wake_e = list_begin(&sleep_list); wake_e != list_end(&sleep_list);)
-  {
-    struct thread *t = list_entry(wake_e, struct thread, elem);
-    /* When it's time to wake up the thread */
-    if (ticks >= t->wakeup)
-    {
-      /* Remove the thread from sleep list */
-      wake_e = list_remove(&t->elem);
-      /* Make thread to THREAD_READY state and schedule */
-      thread_unblock(t);
-    }
-    else
-    {
-      wake_e = list_next(wake_e);
-      /* Update value of next_wakeup variable */
-      update_wakeup(t->wakeup);
-    }
-  }
+  struct thread *t = t_;
+
+  thread_unblock (t);
+  if (t->priority > thread_current ()->priority)
+    intr_yield_on_return ();
 }
 
 /* For priority scheduling */
-/* Compare the priority between two threads */
-bool 
-compare_priority(const struct list_elem *a,
-                 const struct list_elem *b, void* aux UNUSED)
-{
-  /* Return the two threads as struct thread */
-  struct thread *t_a = list_entry(a, struct thread, elem);
-  struct thread *t_b = list_entry(b, struct thread, elem);
-  /* Compare the priority */
-  if (t_a->priority > t_b->priority)
-    return true;
-  else return false;
-}
 /* Compare the priority of the current thread with the highest 
-   priority thread in ready_list and scheduling */
+   priority thread in the run queue and scheduling */
 void
 max_compare_priority(void)
 { 
-  /* If the ready_list is empty, do nothing */
-  if( list_empty(&ready_list) )
-    return;
-  /* Return the highest priority threads as struct thread */
-  struct list_elem *front_e = list_front(&ready_list);
-  struct thread *front_t = list_entry(front_e, struct thread, elem);
   /* If the priority of current thread is lower than highest thread */
-  if(front_t->priority > thread_current()->priority)
+  if(ready_max_priority () > thread_current()->priority)
     /* Give up CPU occupancy and scheduling */
     thread_yield();
 }
 
 /* For priority-donation */
-/* Compare the priority of the donation thread and holder thread 
-   and perform multiple & nested priority donation */
+/* Donate the current thread's priority along the chain of lock
+   holders starting with the holder of the lock it waits for, or
+   to the readers of the readers-writer lock it waits to write.
+
+   Each lock caches the highest priority of the threads waiting
+   for it, and each readers-writer lock that of the writer
+   waiting for its readers, so a holder's priority is the greater
+   of its own and the cached maxima of the locks it holds, and
+   donation only has to raise those caches and priorities along
+   the chain.  The walk stops as soon as a holder already has at
+   least the donated priority, since everything beyond it must
+   too, and in any case after DONATE_DEPTH_MAX locks, so a long
+   or cyclic chain cannot keep interrupts off for long. */
+#define DONATE_DEPTH_MAX 8
 void
 priority_donate(void)
 {
-  /* Return 2 thread for compare and 1 lock */
   struct thread *t = thread_current();
-  struct lock *wait_l = t->wait_lock;
-  struct thread *holder_t = wait_l->holder;
-  /* Search the donation list of holder */
-  while(true)
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  donate_chain (t, t->priority, 0);
+}
+/* Donate PRIORITY to the threads that T waits for, and on down
+   the chain from them, DEPTH locks having been walked so far */
+static void
+donate_chain (struct thread *t, int priority, int depth)
+{
+  for (; depth < DONATE_DEPTH_MAX; depth++)
   {
-    /* Compare the priority of the donation thread and holder thread */
-    if(t->priority > holder_t->priority)
-      /* Execute priority donation */
-      holder_t->priority = t->priority;
-    /* Change wait_l to holder's wait_lock */
-    wait_l = holder_t->wait_lock;
-    /* If nested priority donation case exists*/
-    if(wait_l != NULL)
+    struct lock *l = t->wait_lock;
+    struct rwlock *rw = t->wait_rwlock;
+    struct list_elem *e;
+
+    if (l != NULL)
     {
-      /* Change donation thread to holder thread */
-      t = holder_t;
-      /* Change holder thread to next holder thread */
-      holder_t = wait_l->holder;
+      struct thread *holder = l->holder;
+      /* Remember the new top waiter of the lock */
+      if (l->max_priority < priority)
+        l->max_priority = priority;
+      /* Stop when nobody down the chain needs a higher priority */
+      if (holder == NULL || holder->priority >= priority)
+        return;
+      /* Execute priority donation */
+      set_priority (holder, priority);
+      /* Nested priority donation */
+      t = holder;
+      continue;
     }
-    /* Escape condtion of while */
-    else return;
-  }
-}
-/* When the lock is released, remove the thread from donation list */
-void
-remove_lock(struct lock *lock)
-{
-  /* Return thread and list_elem for search */
-  struct thread *holder_t = lock->holder;
-  struct list_elem *e;
-  /* Search the donation list of holder */
-  for(e=list_begin(&holder_t->donation); e!=list_end(&holder_t->donation);
-      e=list_next(e))
-  { 
-    struct thread *remove_t = list_entry(e, struct thread, elem_donation);
-    /* When the wait_lock of some thread is released lock */
-    if(remove_t->wait_lock == lock)
+    if (rw == NULL)
+      return;
+
+    /* Remember the priority of the writer waiting for the readers */
+    if (rw->max_priority < priority)
+      rw->max_priority = priority;
+    /* Donate to every reader still inside, and on from each */
+    for (e = list_begin (&rw->reader_list);
+         e != list_end (&rw->reader_list); e = list_next (e))
     {
-      /* remove the thread from donation list */
-      struct list_elem *pre = list_prev(e);
-      list_remove(&remove_t->elem_donation);
-      e = pre;
+      struct thread *reader = list_entry (e, struct read_hold, elem)->thread;
+      if (reader->priority < priority)
+      {
+        set_priority (reader, priority);
+        donate_chain (reader, priority, depth + 1);
+      }
     }
+    return;
   }
 }
-/* Change the priority of the current thread to initial priority
-   and perform priority donation again */
+/* Recalculate the current thread's priority from its own priority
+   and the cached top waiter priorities of the locks it holds,
+   including those it holds for reading */
 void
 recover_priority(void)
 {
   struct thread *t = thread_current();
-  /* Return list_elem of the first thread in donation list */
-  struct list_elem *e = list_begin(&t->donation);
-  /* Change the priority of the current thread to initial priority */
-  t->priority = t->init_priority;
-  /* When the donation thread exists */
-  if(e!=NULL)
+  struct list_elem *e;
+  enum intr_level old_level;
+  int i;
+  /* Start from the initial priority of the current thread */
+  int priority = t->init_priority;
+
+  old_level = intr_disable ();
+  /* Take the highest priority among the held locks' waiters */
+  for (e = list_begin (&t->held_locks); e != list_end (&t->held_locks);
+       e = list_next (e))
   {
-    struct thread *donate_t = list_entry(e, struct thread, elem_donation);
-    /* Compare the priority of current thread with donation thread */
-    if(donate_t->priority > t->priority)
-      /* Execute priority donation */
-      t->priority = donate_t->priority;
+    struct lock *l = list_entry(e, struct lock, elem);
+    if(l->max_priority > priority)
+      priority = l->max_priority;
   }
+  /* And the writers waiting for it to stop reading */
+  for (i = 0; i < READ_HOLD_MAX; i++)
+  {
+    struct rwlock *rw = t->read_holds[i].rwlock;
+    if(rw != NULL && rw->max_priority > priority)
+      priority = rw->max_priority;
+  }
+  set_priority (t, priority);
+  intr_set_level (old_level);
 }
 
 /* For 4BSD scheduler */
@@ -861,7 +1070,7 @@ bsd_priority (struct thread *t)
     /* Round the calculated value */
     cal_priority = fp_to_int_round(cal_priority);
     /* Update the priority of current thread with calculated value */
-    t->priority = cal_priority;
+    set_priority (t, cal_priority);
   }
 }
 /* Calculate the recent cpu of 4BSD scheduler case */
@@ -893,11 +1102,11 @@ bsd_load_avg (void)
 {
   int cal_load_avg;
   int factor1, factor2;
-  /* Count the number of threads in ready_list */
-  int num_ready_thread = list_size(&ready_list);
+  /* Count the number of ready threads */
+  int num_ready_thread = ready_cnt;
   /* When the current thread is not idle_thread */
   if(thread_current()!=idle_thread)
-    /* Since list_size functino return 1 less than the actual value */
+    /* Count the running thread too */
     num_ready_thread++;
   /* Calculate and make fixed pioner to 59*load_avg */
   factor1 = mult_mixed(load_avg,59);
@@ -922,21 +1131,62 @@ bsd_increment (void)
     /* Increse the recent cpu value by 1 */
     t->recent_cpu = add_mixed(t->recent_cpu, 1);
 }
-/* Recalculate the recent cpu and priority of all threads */
+/* Recalculate the recent cpu and priority of the running thread,
+   once a second.  Ready and blocked threads are left alone: their
+   run queues are marked stale and caught up by the scheduler, and
+   blocked threads when they are unblocked, so the cost of this,
+   which is paid in the timer interrupt, does not grow with the
+   number of threads. */
 void
 bsd_recalc (void)
 {
-  struct list_elem *e;
-  /* Search all threads in all list */
-  for (e = list_begin(&all_list); e != list_end(&all_list);
-       e = list_next(e))
+  struct thread *cur = thread_current ();
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  bsd_seconds++;
+  ready_stale_mask = ready_mask;
+
+  bsd_recent_cpu (cur);
+  cur->cpu_second = bsd_seconds;
+  bsd_priority (cur);
+}
+/* Apply to T, which is about to be unblocked or is in a stale
+   run queue, the recent cpu decays it missed while it was
+   blocked or ready, then recalculate its priority.  As in
+   4.4BSD, the decay for every missed second is taken from the
+   current load average, which lets it be done in closed form:
+
+     recent_cpu = d^k * recent_cpu + nice * (1 - d^k) / (1 - d)
+
+   where d = (2*load_avg)/(2*load_avg + 1) is the decay per
+   second, k is the number of seconds missed, and 1 / (1 - d) is
+   2*load_avg + 1. */
+static void
+bsd_catch_up (struct thread *t)
+{
+  int64_t k = bsd_seconds - t->cpu_second;
+  int factor, decay, decay_k;
+
+  t->cpu_second = bsd_seconds;
+  if (k <= 0 || t == idle_thread)
+    return;
+
+  /* Calculate d^k by repeated squaring */
+  factor = mult_mixed(load_avg, 2);
+  decay = div_fp(factor, add_mixed(factor, 1));
+  for (decay_k = int_to_fp(1); k > 0 && decay_k != 0; k >>= 1)
   {
-    struct thread *t = list_entry(e, struct thread, allelem);
-    /* Recalculate the recent cpu */
-    bsd_recent_cpu(t);
-    /*Recalculate the priority */
-    bsd_priority(t);
+    if (k & 1)
+      decay_k = mult_fp(decay_k, decay);
+    decay = mult_fp(decay, decay);
   }
+
+  t->recent_cpu = add_fp(mult_fp(decay_k, t->recent_cpu),
+                         mult_mixed(mult_fp(sub_fp(int_to_fp(1), decay_k),
+                                            add_mixed(factor, 1)),
+                                    t->nice));
+  bsd_priority(t);
 }
 /* Offset of `stack' member within `struct thread'.
    Used by switch.S, which can't figure it out on its own. */
@@ -2,9 +2,14 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <heap.h>
 #include <list.h>
 #include <stdint.h>
 
+struct semaphore;
+struct condition;
+struct rwlock;
+
 /* States in a thread's life cycle. */
 enum thread_status
   {
@@ -79,12 +84,24 @@ typedef int tid_t;
    the `magic' member of the running thread's `struct thread' is
    set to THREAD_MAGIC.  Stack overflow will normally change this
    value, triggering the assertion. */
-/* The `elem' member has a dual purpose.  It can be an element in
-   the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+/* A readers-writer lock that a thread holds for reading, so that
+   a writer waiting for the readers to leave can donate its
+   priority to them (synch.c).  A thread tracks at most
+   READ_HOLD_MAX such locks at once; beyond that it still reads,
+   but without donation. */
+#define READ_HOLD_MAX 4
+struct read_hold
+  {
+    struct list_elem elem;      /* Element in rwlock's reader_list. */
+    struct rwlock *rwlock;      /* Lock held, or null if slot is free. */
+    struct thread *thread;      /* Reader holding it. */
+  };
+
+/* The `elem' member is an element in the run queue (thread.c).
+   A thread waiting on a semaphore is instead in the semaphore's
+   waiters heap through `waitelem' (synch.c), which is ordered by
+   priority and has to be reordered when the waiting thread's
+   priority changes through donation. */
 struct thread
   {
     /* Owned by thread.c. */
@@ -98,6 +115,13 @@ struct thread
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
 
+    /* Owned by synch.c. */
+    struct heap_elem waitelem;          /* Semaphore waiters element. */
+    unsigned wait_seq;                  /* Orders equal-priority waiters. */
+    struct semaphore *wait_sema;        /* Semaphore being waited on. */
+    struct condition *wait_cond;        /* Condition being waited on. */
+    struct heap_elem *cond_elem;        /* Element in wait_cond's waiters. */
+
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
@@ -107,18 +131,17 @@ struct thread
     unsigned magic;                     /* Detects stack overflow. */
 
     /* Added variables */
-    /* For Alarm clock */
-    int64_t wakeup;          /* Stores the tick that thread wake up */ 
-
     /* For priority-donation */
     int init_priority;         /* Stores the initial priority of the thread  */     
     struct lock *wait_lock;    /* Stores lock that the thread is waiting for */ 
-    struct list donation;      /* List of donation threads */ 
-    struct list_elem elem_donation;  /* List element of donation threads */ 
+    struct list held_locks;    /* Locks held, each caching its top waiter */
+    struct rwlock *wait_rwlock;  /* Stores rwlock whose readers it waits for */
+    struct read_hold read_holds[READ_HOLD_MAX];  /* Rwlocks held to read */
 
     /* For 4BSD scheduler */
     int nice;               /* Stores the nice value of the thread  */   
     int recent_cpu;         /* Stores the recent cpu value of the thread  */   
+    int64_t cpu_second;     /* Second up to which recent_cpu is decayed */
   };
 
 /* If false (default), use round-robin scheduler.
@@ -126,10 +149,14 @@ struct thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true (default), recycle the pages of exiting threads. */
+extern bool thread_cache_enabled;
+
 void thread_init (void);
 void thread_start (void);
 
 void thread_tick (void);
+void thread_idle_tick (void);
 void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
@@ -160,18 +187,12 @@ int thread_get_load_avg (void);
 /* Added Function */
 /* For Alarm clock */
 void thread_sleep(int64_t ticks);
-void update_wakeup(int64_t ticks);
-int64_t return_wakeup(void);
-void thread_awake(int64_t ticks);
 
 /* For priority scheduling */
-bool compare_priority(const struct list_elem *a,
-                      const struct list_elem *b, void* aux UNUSED);
-int return_max_priority(struct list *list);
+void max_compare_priority(void);
 
 /* For priority-donation */
 void priority_donate(void);
-void remove_lock(struct lock *lock);
 void recover_priority(void);
 
 /* For 4BSD scheduler */
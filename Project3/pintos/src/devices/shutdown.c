@@ -4,7 +4,9 @@
 #include "devices/kbd.h"
 #include "devices/serial.h"
 #include "devices/timer.h"
+#include "threads/alloc-track.h"
 #include "threads/io.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
@@ -120,6 +122,8 @@ print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
+  kmem_cache_print_stats ();
+  alloc_track_print ();
 #ifdef FILESYS
   block_print_stats ();
 #endif
@@ -84,6 +84,19 @@ timer_elapsed (int64_t then)
   return timer_ticks () - then;
 }
 
+/* Returns the CPU's time-stamp counter, which counts processor
+   cycles since reset.  Much finer grained than timer_ticks(), so
+   it is suitable for timing short events such as a single hash
+   table operation, but the rate depends on the CPU (or emulator)
+   clock. */
+uint64_t
+timer_cycles (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
    be turned on. */
 void
@@ -3,21 +3,53 @@
    This data structure is thoroughly documented in the Tour of
    Pintos for Project 3.
 
-   See hash.h for basic information. */
+   See hash.h for basic information.
+
+   Elements are placed by linear probing with the Robin Hood
+   rule: each element sits at or after its "home" slot, the one
+   its hash value selects, and an element being inserted displaces
+   any element it finds that is closer to its own home, then goes
+   on to insert the displaced one in its place.  This keeps every
+   element's distance from home short and even, and it means a
+   search can stop as soon as it reaches an element closer to its
+   home than the one sought would be.  Deletion shifts the
+   elements that follow back by one slot, so no "deleted" markers
+   are needed.
+
+   When the table needs to grow or shrink, it allocates the new
+   slot array but does not move everything into it at once.
+   Instead, each later insertion or deletion moves MOVE_STEP of
+   the old slots' elements across, so that no single operation
+   takes time proportional to the size of the table.  New
+   elements always go into the new slots, and searches look in
+   both arrays until the move is complete.  The old slots are
+   moved in order, starting from a slot at which no element's
+   probe sequence begins before and ends after, so that the
+   emptied slots always form one contiguous run that a search of
+   the old slots can simply skip over. */
 
 #include "hash.h"
 #include "../debug.h"
 #include "threads/malloc.h"
 
-#define list_elem_to_hash_elem(LIST_ELEM)                       \
-        list_entry(LIST_ELEM, struct hash_elem, list_elem)
-
-static struct list *find_bucket (struct hash *, struct hash_elem *);
-static struct hash_elem *find_elem (struct hash *, struct list *,
-                                    struct hash_elem *);
-static void insert_elem (struct hash *, struct list *, struct hash_elem *);
-static void remove_elem (struct hash *, struct hash_elem *);
-static void rehash (struct hash *);
+/* Table sizing. */
+#define MIN_SLOT_CNT 8          /* Never fewer slots than this. */
+#define MOVE_STEP 8             /* Old slots moved per insert or delete. */
+
+static unsigned hash_of (struct hash *, const struct hash_elem *);
+static struct hash_slot *find_slot (struct hash *, struct hash_elem *,
+                                    unsigned hash, bool *old);
+static struct hash_slot *find_old_slot (struct hash *, struct hash_elem *,
+                                        unsigned hash);
+static struct hash_elem *insert_elem (struct hash *, struct hash_elem *,
+                                      unsigned hash);
+static void insert_slot (struct hash_slot *, size_t slot_cnt,
+                         size_t idx, size_t dist,
+                         unsigned hash, struct hash_elem *);
+static void remove_slot (struct hash_slot *, size_t slot_cnt, size_t idx);
+static struct hash_slot *alloc_slots (size_t slot_cnt);
+static void resize (struct hash *);
+static void move_old (struct hash *, size_t slot_cnt);
 
 /* Initializes hash table H to compute hash values using HASH and
    compare hash elements using LESS, given auxiliary data AUX. */
@@ -26,19 +58,14 @@ hash_init (struct hash *h,
            hash_hash_func *hash, hash_less_func *less, void *aux) 
 {
   h->elem_cnt = 0;
-  h->bucket_cnt = 4;
-  h->buckets = malloc (sizeof *h->buckets * h->bucket_cnt);
+  h->slot_cnt = MIN_SLOT_CNT;
+  h->slots = alloc_slots (h->slot_cnt);
   h->hash = hash;
   h->less = less;
   h->aux = aux;
+  h->old_slots = NULL;
 
-  if (h->buckets != NULL) 
-    {
-      hash_clear (h, NULL);
-      return true;
-    }
-  else
-    return false;
+  return h->slots != NULL;
 }
 
 /* Removes all the elements from H.
@@ -55,19 +82,23 @@ hash_clear (struct hash *h, hash_action_func *destructor)
 {
   size_t i;
 
-  for (i = 0; i < h->bucket_cnt; i++) 
+  if (h->old_slots != NULL)
     {
-      struct list *bucket = &h->buckets[i];
+      if (destructor != NULL)
+        for (i = 0; i < h->old_slot_cnt; i++)
+          if (h->old_slots[i].elem != NULL)
+            destructor (h->old_slots[i].elem, h->aux);
+      free (h->old_slots);
+      h->old_slots = NULL;
+    }
 
-      if (destructor != NULL) 
-        while (!list_empty (bucket)) 
-          {
-            struct list_elem *list_elem = list_pop_front (bucket);
-            struct hash_elem *hash_elem = list_elem_to_hash_elem (list_elem);
-            destructor (hash_elem, h->aux);
-          }
+  for (i = 0; i < h->slot_cnt; i++) 
+    {
+      struct hash_slot *slot = &h->slots[i];
 
-      list_init (bucket); 
+      if (destructor != NULL && slot->elem != NULL)
+        destructor (slot->elem, h->aux);
+      slot->elem = NULL;
     }    
 
   h->elem_cnt = 0;
@@ -88,7 +119,8 @@ hash_destroy (struct hash *h, hash_action_func *destructor)
 {
   if (destructor != NULL)
     hash_clear (h, destructor);
-  free (h->buckets);
+  free (h->old_slots);
+  free (h->slots);
 }
 
 /* Inserts NEW into hash table H and returns a null pointer, if
@@ -98,15 +130,17 @@ hash_destroy (struct hash *h, hash_action_func *destructor)
 struct hash_elem *
 hash_insert (struct hash *h, struct hash_elem *new)
 {
-  struct list *bucket = find_bucket (h, new);
-  struct hash_elem *old = find_elem (h, bucket, new);
+  unsigned hash = hash_of (h, new);
+  struct hash_slot *slot;
 
-  if (old == NULL) 
-    insert_elem (h, bucket, new);
-
-  rehash (h);
-
-  return old; 
+  resize (h);
+  if (h->old_slots != NULL)
+    {
+      slot = find_old_slot (h, new, hash);
+      if (slot != NULL)
+        return slot->elem;
+    }
+  return insert_elem (h, new, hash);
 }
 
 /* Inserts NEW into hash table H, replacing any equal element
@@ -114,16 +148,21 @@ hash_insert (struct hash *h, struct hash_elem *new)
 struct hash_elem *
 hash_replace (struct hash *h, struct hash_elem *new) 
 {
-  struct list *bucket = find_bucket (h, new);
-  struct hash_elem *old = find_elem (h, bucket, new);
+  unsigned hash = hash_of (h, new);
+  bool old;
+  struct hash_slot *slot = find_slot (h, new, hash, &old);
+  struct hash_elem *old_elem;
 
-  if (old != NULL)
-    remove_elem (h, old);
-  insert_elem (h, bucket, new);
+  if (slot == NULL)
+    return hash_insert (h, new);
 
-  rehash (h);
+  /* An equal element has the same hash value, so NEW can take
+     its slot. */
+  old_elem = slot->elem;
+  new->hash = hash;
+  slot->elem = new;
 
-  return old;
+  return old_elem;
 }
 
 /* Finds and returns an element equal to E in hash table H, or a
@@ -131,7 +170,9 @@ hash_replace (struct hash *h, struct hash_elem *new)
 struct hash_elem *
 hash_find (struct hash *h, struct hash_elem *e) 
 {
-  return find_elem (h, find_bucket (h, e), e);
+  bool old;
+  struct hash_slot *slot = find_slot (h, e, hash_of (h, e), &old);
+  return slot != NULL ? slot->elem : NULL;
 }
 
 /* Finds, removes, and returns an element equal to E in hash
@@ -144,12 +185,23 @@ hash_find (struct hash *h, struct hash_elem *e)
 struct hash_elem *
 hash_delete (struct hash *h, struct hash_elem *e)
 {
-  struct hash_elem *found = find_elem (h, find_bucket (h, e), e);
-  if (found != NULL) 
-    {
-      remove_elem (h, found);
-      rehash (h); 
-    }
+  unsigned hash = hash_of (h, e);
+  bool old;
+  struct hash_slot *slot = find_slot (h, e, hash, &old);
+  struct hash_elem *found;
+
+  if (slot == NULL)
+    return NULL;
+
+  found = slot->elem;
+  ASSERT (found->hash == hash);
+  if (old)
+    remove_slot (h->old_slots, h->old_slot_cnt, slot - h->old_slots);
+  else
+    remove_slot (h->slots, h->slot_cnt, slot - h->slots);
+  h->elem_cnt--;
+  resize (h);
+
   return found;
 }
 
@@ -166,17 +218,13 @@ hash_apply (struct hash *h, hash_action_func *action)
   
   ASSERT (action != NULL);
 
-  for (i = 0; i < h->bucket_cnt; i++) 
-    {
-      struct list *bucket = &h->buckets[i];
-      struct list_elem *elem, *next;
-
-      for (elem = list_begin (bucket); elem != list_end (bucket); elem = next) 
-        {
-          next = list_next (elem);
-          action (list_elem_to_hash_elem (elem), h->aux);
-        }
-    }
+  if (h->old_slots != NULL)
+    for (i = 0; i < h->old_slot_cnt; i++)
+      if (h->old_slots[i].elem != NULL)
+        action (h->old_slots[i].elem, h->aux);
+  for (i = 0; i < h->slot_cnt; i++) 
+    if (h->slots[i].elem != NULL)
+      action (h->slots[i].elem, h->aux);
 }
 
 /* Initializes I for iterating hash table H.
@@ -203,8 +251,8 @@ hash_first (struct hash_iterator *i, struct hash *h)
   ASSERT (h != NULL);
 
   i->hash = h;
-  i->bucket = i->hash->buckets;
-  i->elem = list_elem_to_hash_elem (list_head (i->bucket));
+  i->pos = 0;
+  i->elem = NULL;
 }
 
 /* Advances I to the next element in the hash table and returns
@@ -218,17 +266,21 @@ hash_first (struct hash_iterator *i, struct hash *h)
 struct hash_elem *
 hash_next (struct hash_iterator *i)
 {
+  struct hash *h;
+  size_t old_cnt;
+
   ASSERT (i != NULL);
 
-  i->elem = list_elem_to_hash_elem (list_next (&i->elem->list_elem));
-  while (i->elem == list_elem_to_hash_elem (list_end (i->bucket)))
+  h = i->hash;
+  old_cnt = h->old_slots != NULL ? h->old_slot_cnt : 0;
+  i->elem = NULL;
+  while (i->elem == NULL && i->pos < old_cnt + h->slot_cnt)
     {
-      if (++i->bucket >= i->hash->buckets + i->hash->bucket_cnt)
-        {
-          i->elem = NULL;
-          break;
-        }
-      i->elem = list_elem_to_hash_elem (list_begin (i->bucket));
+      size_t pos = i->pos++;
+      if (pos < old_cnt)
+        i->elem = h->old_slots[pos].elem;
+      else
+        i->elem = h->slots[pos - old_cnt].elem;
     }
   
   return i->elem;
@@ -301,130 +353,264 @@ hash_int (int i)
   return hash_bytes (&i, sizeof i);
 }
 
-/* Returns the bucket in H that E belongs in. */
-static struct list *
-find_bucket (struct hash *h, struct hash_elem *e) 
+/* Returns the hash value of E in H.  The value from H's hash
+   function is scrambled so that keys with similar hash values,
+   such as consecutive page addresses, land in scattered slots
+   rather than in one long run of occupied ones. */
+static unsigned
+hash_of (struct hash *h, const struct hash_elem *e)
+{
+  unsigned x = h->hash (e, h->aux);
+
+  x ^= x >> 16;
+  x *= 0x45d9f3bu;
+  x ^= x >> 16;
+  return x;
+}
+
+/* Returns the distance of SLOT, the element at index IDX in an
+   array of SLOT_CNT slots, from its home slot. */
+static inline size_t
+home_dist (const struct hash_slot *slot, size_t idx, size_t slot_cnt)
+{
+  return (idx - slot->hash) & (slot_cnt - 1);
+}
+
+/* Searches the SLOT_CNT SLOTS in H for an element equal to E,
+   whose hash value is HASH, starting from index IDX, which is
+   DIST slots from E's home slot.  Returns its slot if found or a
+   null pointer otherwise. */
+static struct hash_slot *
+probe (struct hash *h, struct hash_slot *slots, size_t slot_cnt,
+       size_t idx, size_t dist, unsigned hash, struct hash_elem *e)
+{
+  for (; dist < slot_cnt; idx = (idx + 1) & (slot_cnt - 1), dist++)
+    {
+      struct hash_slot *slot = &slots[idx];
+
+      if (slot->elem == NULL || home_dist (slot, idx, slot_cnt) < dist)
+        break;
+      if (slot->hash == hash
+          && !h->less (slot->elem, e, h->aux)
+          && !h->less (e, slot->elem, h->aux))
+        return slot;
+    }
+  return NULL;
+}
+
+/* Searches H for an element equal to E, whose hash value is
+   HASH.  Returns its slot if found or a null pointer otherwise,
+   and sets *OLD to whether the slot is one of H's old slots. */
+static struct hash_slot *
+find_slot (struct hash *h, struct hash_elem *e, unsigned hash, bool *old)
+{
+  struct hash_slot *slot;
+
+  *old = false;
+  slot = probe (h, h->slots, h->slot_cnt, hash & (h->slot_cnt - 1), 0,
+                hash, e);
+  if (slot == NULL && h->old_slots != NULL)
+    {
+      *old = true;
+      slot = find_old_slot (h, e, hash);
+    }
+  return slot;
+}
+
+/* Searches H's old slots, which must exist, for an element equal
+   to E, whose hash value is HASH.  Returns its slot if found or a
+   null pointer otherwise. */
+static struct hash_slot *
+find_old_slot (struct hash *h, struct hash_elem *e, unsigned hash)
 {
-  size_t bucket_idx = h->hash (e, h->aux) & (h->bucket_cnt - 1);
-  return &h->buckets[bucket_idx];
+  /* Skip over the old slots that have already been emptied, from
+     E's home slot up to the first one still to be moved. */
+  size_t mask = h->old_slot_cnt - 1;
+  size_t home = hash & mask;
+  size_t ofs = (home - h->old_start) & mask;
+  size_t dist = ofs < h->old_moved ? h->old_moved - ofs : 0;
+
+  return probe (h, h->old_slots, h->old_slot_cnt, (home + dist) & mask,
+                dist, hash, e);
 }
 
-/* Searches BUCKET in H for a hash element equal to E.  Returns
-   it if found or a null pointer otherwise. */
+/* Searches H's current slots for an element equal to E, whose
+   hash value is HASH, and returns it if found.  Otherwise,
+   inserts E and returns a null pointer.  The search stops at the
+   slot where E belongs, so insertion carries on from there. */
 static struct hash_elem *
-find_elem (struct hash *h, struct list *bucket, struct hash_elem *e) 
+insert_elem (struct hash *h, struct hash_elem *e, unsigned hash)
 {
-  struct list_elem *i;
+  size_t mask = h->slot_cnt - 1;
+  size_t idx = hash & mask;
+  size_t dist = 0;
 
-  for (i = list_begin (bucket); i != list_end (bucket); i = list_next (i)) 
+  for (;; idx = (idx + 1) & mask, dist++)
     {
-      struct hash_elem *hi = list_elem_to_hash_elem (i);
-      if (!h->less (hi, e, h->aux) && !h->less (e, hi, h->aux))
-        return hi; 
+      struct hash_slot *slot = &h->slots[idx];
+
+      if (slot->elem == NULL || home_dist (slot, idx, h->slot_cnt) < dist)
+        break;
+      if (slot->hash == hash
+          && !h->less (slot->elem, e, h->aux)
+          && !h->less (e, slot->elem, h->aux))
+        return slot->elem;
     }
+
+  e->hash = hash;
+  insert_slot (h->slots, h->slot_cnt, idx, dist, hash, e);
+  h->elem_cnt++;
   return NULL;
 }
 
-/* Returns X with its lowest-order bit set to 1 turned off. */
-static inline size_t
-turn_off_least_1bit (size_t x) 
+/* Inserts E, whose hash value is HASH, into the SLOT_CNT SLOTS,
+   which must not be full, starting the search for a place at
+   index IDX, which is DIST slots from E's home slot. */
+static void
+insert_slot (struct hash_slot *slots, size_t slot_cnt, size_t idx,
+             size_t dist, unsigned hash, struct hash_elem *e)
 {
-  return x & (x - 1);
+  struct hash_slot new;
+
+  new.hash = hash;
+  new.elem = e;
+  for (;; idx = (idx + 1) & (slot_cnt - 1), dist++)
+    {
+      struct hash_slot *slot = &slots[idx];
+      size_t slot_dist;
+
+      if (slot->elem == NULL)
+        {
+          *slot = new;
+          return;
+        }
+
+      /* Take the slot from an element closer to its home, and
+         carry on inserting that element instead. */
+      slot_dist = home_dist (slot, idx, slot_cnt);
+      if (slot_dist < dist)
+        {
+          struct hash_slot displaced = *slot;
+          *slot = new;
+          new = displaced;
+          dist = slot_dist;
+        }
+    }
 }
 
-/* Returns true if X is a power of 2, otherwise false. */
-static inline size_t
-is_power_of_2 (size_t x) 
+/* Removes the element at index IDX from the SLOT_CNT SLOTS,
+   shifting back by one slot the elements after it that are not
+   in their home slots. */
+static void
+remove_slot (struct hash_slot *slots, size_t slot_cnt, size_t idx)
 {
-  return x != 0 && turn_off_least_1bit (x) == 0;
+  for (;;)
+    {
+      size_t next = (idx + 1) & (slot_cnt - 1);
+
+      if (slots[next].elem == NULL
+          || home_dist (&slots[next], next, slot_cnt) == 0)
+        break;
+      slots[idx] = slots[next];
+      idx = next;
+    }
+  slots[idx].elem = NULL;
 }
 
-/* Element per bucket ratios. */
-#define MIN_ELEMS_PER_BUCKET  1 /* Elems/bucket < 1: reduce # of buckets. */
-#define BEST_ELEMS_PER_BUCKET 2 /* Ideal elems/bucket. */
-#define MAX_ELEMS_PER_BUCKET  4 /* Elems/bucket > 4: increase # of buckets. */
+/* Allocates and returns an array of SLOT_CNT empty slots, or a
+   null pointer if memory is not available. */
+static struct hash_slot *
+alloc_slots (size_t slot_cnt)
+{
+  return calloc (slot_cnt, sizeof (struct hash_slot));
+}
 
-/* Changes the number of buckets in hash table H to match the
-   ideal.  This function can fail because of an out-of-memory
-   condition, but that'll just make hash accesses less efficient;
-   we can still continue. */
+/* Moves more of H's elements out of its old slots, if it is
+   being resized, and otherwise starts resizing H if it has grown
+   too full or too empty.  Resizing can fail because of an
+   out-of-memory condition, but that'll just make hash accesses
+   less efficient; we can still continue, until every slot is
+   full. */
 static void
-rehash (struct hash *h) 
+resize (struct hash *h) 
 {
-  size_t old_bucket_cnt, new_bucket_cnt;
-  struct list *new_buckets, *old_buckets;
-  size_t i;
+  struct hash_slot *new_slots;
+  size_t new_slot_cnt;
 
   ASSERT (h != NULL);
 
-  /* Save old bucket info for later use. */
-  old_buckets = h->buckets;
-  old_bucket_cnt = h->bucket_cnt;
-
-  /* Calculate the number of buckets to use now.
-     We want one bucket for about every BEST_ELEMS_PER_BUCKET.
-     We must have at least four buckets, and the number of
-     buckets must be a power of 2. */
-  new_bucket_cnt = h->elem_cnt / BEST_ELEMS_PER_BUCKET;
-  if (new_bucket_cnt < 4)
-    new_bucket_cnt = 4;
-  while (!is_power_of_2 (new_bucket_cnt))
-    new_bucket_cnt = turn_off_least_1bit (new_bucket_cnt);
-
-  /* Don't do anything if the bucket count wouldn't change. */
-  if (new_bucket_cnt == old_bucket_cnt)
+  if (h->old_slots != NULL)
+    move_old (h, MOVE_STEP);
+  if (h->old_slots != NULL)
     return;
 
-  /* Allocate new buckets and initialize them as empty. */
-  new_buckets = malloc (sizeof *new_buckets * new_bucket_cnt);
-  if (new_buckets == NULL) 
+  /* Grow when 3/4 full, shrink when less than 1/8 full.
+     Resizing by a factor of 2 leaves the new slots 3/8 or 1/4
+     full, and MOVE_STEP is big enough that every old slot has
+     been moved before the new slots can fill up to the point of
+     resizing again. */
+  if (h->elem_cnt >= h->slot_cnt / 4 * 3)
+    new_slot_cnt = h->slot_cnt * 2;
+  else if (h->elem_cnt < h->slot_cnt / 8 && h->slot_cnt > MIN_SLOT_CNT)
+    new_slot_cnt = h->slot_cnt / 2;
+  else
+    return;
+
+  new_slots = alloc_slots (new_slot_cnt);
+  if (new_slots == NULL) 
     {
       /* Allocation failed.  This means that use of the hash table will
          be less efficient.  However, it is still usable, so
-         there's no reason for it to be an error. */
+         there's no reason for it to be an error, until it is
+         completely full. */
+      if (h->elem_cnt + 1 >= h->slot_cnt)
+        PANIC ("out of memory growing hash table");
       return;
     }
-  for (i = 0; i < new_bucket_cnt; i++) 
-    list_init (&new_buckets[i]);
 
-  /* Install new bucket info. */
-  h->buckets = new_buckets;
-  h->bucket_cnt = new_bucket_cnt;
+  /* Make the current slots the old slots, and start moving them
+     from one that no probe sequence runs across: an empty slot
+     or one holding an element in its home slot.  There must be
+     an empty slot because the slots are never allowed to fill
+     up. */
+  h->old_slots = h->slots;
+  h->old_slot_cnt = h->slot_cnt;
+  h->old_start = 0;
+  while (h->old_slots[h->old_start].elem != NULL
+         && home_dist (&h->old_slots[h->old_start], h->old_start,
+                       h->old_slot_cnt) != 0)
+    h->old_start++;
+  h->old_moved = 0;
+  h->slots = new_slots;
+  h->slot_cnt = new_slot_cnt;
+
+  move_old (h, MOVE_STEP);
+}
 
-  /* Move each old element into the appropriate new bucket. */
-  for (i = 0; i < old_bucket_cnt; i++) 
-    {
-      struct list *old_bucket;
-      struct list_elem *elem, *next;
+/* Moves the elements in the next SLOT_CNT of H's old slots into
+   its current slots, and frees the old slots once they are all
+   empty. */
+static void
+move_old (struct hash *h, size_t slot_cnt)
+{
+  size_t mask = h->old_slot_cnt - 1;
 
-      old_bucket = &old_buckets[i];
-      for (elem = list_begin (old_bucket);
-           elem != list_end (old_bucket); elem = next) 
+  while (slot_cnt-- > 0 && h->old_moved < h->old_slot_cnt)
+    {
+      struct hash_slot *slot
+        = &h->old_slots[(h->old_start + h->old_moved++) & mask];
+      if (slot->elem != NULL)
         {
-          struct list *new_bucket
-            = find_bucket (h, list_elem_to_hash_elem (elem));
-          next = list_next (elem);
-          list_remove (elem);
-          list_push_front (new_bucket, elem);
+          insert_slot (h->slots, h->slot_cnt,
+                       slot->hash & (h->slot_cnt - 1), 0,
+                       slot->hash, slot->elem);
+          slot->elem = NULL;
         }
     }
 
-  free (old_buckets);
-}
-
-/* Inserts E into BUCKET (in hash table H). */
-static void
-insert_elem (struct hash *h, struct list *bucket, struct hash_elem *e) 
-{
-  h->elem_cnt++;
-  list_push_front (bucket, &e->list_elem);
-}
-
-/* Removes E from hash table H. */
-static void
-remove_elem (struct hash *h, struct hash_elem *e) 
-{
-  h->elem_cnt--;
-  list_remove (&e->list_elem);
+  if (h->old_moved == h->old_slot_cnt)
+    {
+      free (h->old_slots);
+      h->old_slots = NULL;
+    }
 }
-
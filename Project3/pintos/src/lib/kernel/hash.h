@@ -4,14 +4,23 @@
 /* Hash table.
 
    This data structure is thoroughly documented in the Tour of
-   Pintos for Project 3.
-
-   This is a standard hash table with chaining.  To locate an
-   element in the table, we compute a hash function over the
-   element's data and use that as an index into an array of
-   doubly linked lists, then linearly search the list.
-
-   The chain lists do not use dynamic allocation.  Instead, each
+   Pintos for Project 3, which describes an earlier version that
+   chained elements in a linked list per bucket.  The interface
+   is unchanged.
+
+   This is an open-addressed hash table using Robin Hood linear
+   probing.  The table is an array of slots, each holding a
+   pointer to an element along with the element's hash value.  To
+   locate an element, we compute a hash function over its data,
+   use that as an index into the array, and scan forward from
+   there.  Since each slot carries its hash value, the scan
+   compares hash values within a few adjacent cache lines and
+   calls the comparison function only on a match, instead of
+   following a chain of pointers through memory.  See hash.c for
+   details, including how the table grows a little at a time
+   rather than all at once.
+
+   The table does not allocate memory per element.  Instead, each
    structure that can potentially be in a hash must embed a
    struct hash_elem member.  All of the hash functions operate on
    these `struct hash_elem's.  The hash_entry macro allows
@@ -23,12 +32,11 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
-#include "list.h"
 
 /* Hash element. */
 struct hash_elem 
   {
-    struct list_elem list_elem;
+    unsigned hash;              /* Hash value while in a table. */
   };
 
 /* Converts pointer to hash element HASH_ELEM into a pointer to
@@ -37,8 +45,8 @@ struct hash_elem
    of the hash element.  See the big comment at the top of the
    file for an example. */
 #define hash_entry(HASH_ELEM, STRUCT, MEMBER)                   \
-        ((STRUCT *) ((uint8_t *) &(HASH_ELEM)->list_elem        \
-                     - offsetof (STRUCT, MEMBER.list_elem)))
+        ((STRUCT *) ((uint8_t *) &(HASH_ELEM)->hash             \
+                     - offsetof (STRUCT, MEMBER.hash)))
 
 /* Computes and returns the hash value for hash element E, given
    auxiliary data AUX. */
@@ -55,23 +63,37 @@ typedef bool hash_less_func (const struct hash_elem *a,
    data AUX. */
 typedef void hash_action_func (struct hash_elem *e, void *aux);
 
+/* Slot in a hash table. */
+struct hash_slot
+  {
+    unsigned hash;              /* Hash value of `elem'. */
+    struct hash_elem *elem;     /* Element, or a null pointer if empty. */
+  };
+
 /* Hash table. */
 struct hash 
   {
     size_t elem_cnt;            /* Number of elements in table. */
-    size_t bucket_cnt;          /* Number of buckets, a power of 2. */
-    struct list *buckets;       /* Array of `bucket_cnt' lists. */
+    size_t slot_cnt;            /* Number of slots, a power of 2. */
+    struct hash_slot *slots;    /* Array of `slot_cnt' slots. */
     hash_hash_func *hash;       /* Hash function. */
     hash_less_func *less;       /* Comparison function. */
     void *aux;                  /* Auxiliary data for `hash' and `less'. */
+
+    /* While the table is being resized, the slots it is moving
+       elements out of. */
+    size_t old_slot_cnt;        /* Number of old slots, a power of 2. */
+    struct hash_slot *old_slots; /* Old slots, or a null pointer. */
+    size_t old_start;           /* First old slot to be moved. */
+    size_t old_moved;           /* Number of old slots moved so far. */
   };
 
 /* A hash table iterator. */
 struct hash_iterator 
   {
     struct hash *hash;          /* The hash table. */
-    struct list *bucket;        /* Current bucket. */
-    struct hash_elem *elem;     /* Current hash element in current bucket. */
+    size_t pos;                 /* Next slot, counting old slots first. */
+    struct hash_elem *elem;     /* Current hash element. */
   };
 
 /* Basic life cycle. */
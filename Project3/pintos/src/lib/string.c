@@ -1,5 +1,46 @@
 #include <string.h>
 #include <debug.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* The block functions below move 32-bit words rather than bytes
+   whenever a block is at least WORD_MIN bytes long.  They first
+   go byte by byte until the destination is aligned on a word
+   boundary, then handle whole words, and finish with the bytes
+   left over at the end.  x86 allows unaligned loads, so the
+   source does not have to be aligned too.
+
+   For blocks of at least REP_MIN bytes, memcpy() and memset() use
+   the `rep movsl' and `rep stosl' instructions, which move words
+   faster than a loop once they get going but take a while to
+   start, instead of a C loop. */
+#define WORD_MIN 16
+#define REP_MIN 256
+
+/* A word that may be at any alignment and may alias anything. */
+typedef uint32_t word_t __attribute__ ((may_alias, aligned (1)));
+
+/* The scanning functions below (memchr(), strchr(), strlen(),
+   strnlen()) also look at a word at a time, once they have
+   reached a word boundary.  Reading a whole aligned word may read
+   a few bytes past the end of a string, but never past the end
+   of the page that the string ends in, so it cannot fault. */
+
+/* Returns a word with each byte equal to BYTE. */
+static inline uint32_t
+repeat_byte (unsigned char byte) 
+{
+  return byte * 0x01010101u;
+}
+
+/* Returns true if any byte in WORD is 0.  Subtracting 1 from each
+   byte sets its top bit only if the byte was 0 or above 0x80, and
+   masking with ~WORD rules out the latter. */
+static inline bool
+has_zero_byte (uint32_t word) 
+{
+  return ((word - 0x01010101u) & ~word & 0x80808080u) != 0;
+}
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -12,6 +53,28 @@ memcpy (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
+  if (size >= WORD_MIN) 
+    {
+      size_t words;
+
+      for (; (uintptr_t) dst % sizeof (word_t) != 0; size--)
+        *dst++ = *src++;
+      words = size / sizeof (word_t);
+      size %= sizeof (word_t);
+
+      if (words >= REP_MIN / sizeof (word_t))
+        asm volatile ("rep movsl"
+                      : "+D" (dst), "+S" (src), "+c" (words)
+                      : : "memory");
+      else 
+        for (; words > 0; words--) 
+          {
+            *(word_t *) dst = *(const word_t *) src;
+            dst += sizeof (word_t);
+            src += sizeof (word_t);
+          }
+    }
+
   while (size-- > 0)
     *dst++ = *src++;
 
@@ -29,20 +92,31 @@ memmove (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  if (dst < src) 
+  if (dst < src || dst >= src + size)
     {
-      while (size-- > 0)
-        *dst++ = *src++;
+      /* Copying upward is safe. */
+      return memcpy (dst_, src_, size);
     }
-  else 
+
+  /* Copy downward, a word at a time where possible.  A word is
+     always read before any of it can be overwritten. */
+  dst += size;
+  src += size;
+  if (size >= WORD_MIN) 
     {
-      dst += size;
-      src += size;
-      while (size-- > 0)
+      for (; (uintptr_t) dst % sizeof (word_t) != 0; size--)
         *--dst = *--src;
+      for (; size >= sizeof (word_t); size -= sizeof (word_t)) 
+        {
+          dst -= sizeof (word_t);
+          src -= sizeof (word_t);
+          *(word_t *) dst = *(const word_t *) src;
+        }
     }
+  while (size-- > 0)
+    *--dst = *--src;
 
-  return dst;
+  return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
@@ -58,6 +132,14 @@ memcmp (const void *a_, const void *b_, size_t size)
   ASSERT (a != NULL || size == 0);
   ASSERT (b != NULL || size == 0);
 
+  /* Skip over equal words, then find the differing byte. */
+  for (; size >= sizeof (word_t); size -= sizeof (word_t))
+    {
+      if (*(const word_t *) a != *(const word_t *) b)
+        break;
+      a += sizeof (word_t);
+      b += sizeof (word_t);
+    }
   for (; size-- > 0; a++, b++)
     if (*a != *b)
       return *a > *b ? +1 : -1;
@@ -98,6 +180,23 @@ memchr (const void *block_, int ch_, size_t size)
 
   ASSERT (block != NULL || size == 0);
 
+  for (; size > 0 && (uintptr_t) block % sizeof (word_t) != 0;
+       size--, block++)
+    if (*block == ch)
+      return (void *) block;
+
+  /* Skip words that do not contain CH. */
+  if (size >= sizeof (word_t)) 
+    {
+      uint32_t pattern = repeat_byte (ch);
+      for (; size >= sizeof (word_t); size -= sizeof (word_t))
+        {
+          if (has_zero_byte (*(const word_t *) block ^ pattern))
+            break;
+          block += sizeof (word_t);
+        }
+    }
+
   for (; size-- > 0; block++)
     if (*block == ch)
       return (void *) block;
@@ -113,16 +212,29 @@ char *
 strchr (const char *string, int c_) 
 {
   char c = c_;
+  uint32_t pattern = repeat_byte (c);
 
   ASSERT (string != NULL);
 
   for (;;) 
-    if (*string == c)
-      return (char *) string;
-    else if (*string == '\0')
-      return NULL;
-    else
-      string++;
+    {
+      /* Skip aligned words that contain neither C nor a null. */
+      if ((uintptr_t) string % sizeof (word_t) == 0)
+        for (;;)
+          {
+            uint32_t word = *(const word_t *) string;
+            if (has_zero_byte (word) || has_zero_byte (word ^ pattern))
+              break;
+            string += sizeof (word_t);
+          }
+
+      if (*string == c)
+        return (char *) string;
+      else if (*string == '\0')
+        return NULL;
+      else
+        string++;
+    }
 }
 
 /* Returns the length of the initial substring of STRING that
@@ -281,6 +393,29 @@ memset (void *dst_, int value, size_t size)
   unsigned char *dst = dst_;
 
   ASSERT (dst != NULL || size == 0);
+
+  if (size >= WORD_MIN) 
+    {
+      uint32_t word = (unsigned char) value * 0x01010101u;
+      size_t words;
+
+      for (; (uintptr_t) dst % sizeof (word_t) != 0; size--)
+        *dst++ = value;
+      words = size / sizeof (word_t);
+      size %= sizeof (word_t);
+
+      if (words >= REP_MIN / sizeof (word_t))
+        asm volatile ("rep stosl"
+                      : "+D" (dst), "+c" (words)
+                      : "a" (word)
+                      : "memory");
+      else 
+        for (; words > 0; words--) 
+          {
+            *(word_t *) dst = word;
+            dst += sizeof (word_t);
+          }
+    }
   
   while (size-- > 0)
     *dst++ = value;
@@ -296,8 +431,13 @@ strlen (const char *string)
 
   ASSERT (string != NULL);
 
-  for (p = string; *p != '\0'; p++)
-    continue;
+  for (p = string; (uintptr_t) p % sizeof (word_t) != 0; p++)
+    if (*p == '\0')
+      return p - string;
+  while (!has_zero_byte (*(const word_t *) p))
+    p += sizeof (word_t);
+  while (*p != '\0')
+    p++;
   return p - string;
 }
 
@@ -306,11 +446,9 @@ strlen (const char *string)
 size_t
 strnlen (const char *string, size_t maxlen) 
 {
-  size_t length;
+  const char *end = memchr (string, '\0', maxlen);
 
-  for (length = 0; string[length] != '\0' && length < maxlen; length++)
-    continue;
-  return length;
+  return end != NULL ? (size_t) (end - string) : maxlen;
 }
 
 /* Copies string SRC to DST.  If SRC is longer than SIZE - 1
@@ -0,0 +1,405 @@
+/* Compares the open-addressed hash table in lib/kernel/hash.c
+   against the chained hash table that it replaced, which is
+   reproduced below.  For tables of several sizes, inserts
+   elements keyed on page addresses, as in a supplemental page
+   table, then looks each one up, then deletes them all, and
+   reports the average number of CPU cycles per operation along
+   with the slowest single insertion.  For the chained table, the
+   slowest insertion is the one that rehashed the whole table.
+
+   Before timing anything, runs a long random sequence of
+   insertions, replacements, deletions and lookups against both
+   tables, enough to make the open-addressed table grow and
+   shrink several times, and fails unless every operation returns
+   the same element from both and the tables always hold the same
+   elements. */
+
+#include <hash.h>
+#include <inttypes.h>
+#include <list.h>
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+static const size_t sizes[] = {100, 1000, 10000};
+#define SIZE_CNT (sizeof sizes / sizeof *sizes)
+
+#define CHECK_KEYS 512          /* Distinct keys in the random check. */
+#define CHECK_OPS 40000         /* Operations in the random check. */
+
+/* An element, which can be in both kinds of table. */
+struct item
+  {
+    uintptr_t key;                      /* Page address. */
+    struct hash_elem elem;              /* Open-addressed table element. */
+    struct list_elem chain_elem;        /* Chained table element. */
+  };
+
+/* The chained hash table that lib/kernel/hash.c used to
+   implement, cut down to what the benchmark needs.  It calls the
+   same hash and comparison functions in the same way, so that
+   only the tables' structure differs. */
+struct chain
+  {
+    size_t elem_cnt;            /* Number of elements in table. */
+    size_t bucket_cnt;          /* Number of buckets, a power of 2. */
+    struct list *buckets;       /* Array of `bucket_cnt' lists. */
+    hash_hash_func *hash;       /* Hash function. */
+    hash_less_func *less;       /* Comparison function. */
+  };
+
+/* Times for one table. */
+struct times
+  {
+    uint64_t insert;                    /* Total cycles inserting. */
+    uint64_t insert_max;                /* Slowest insertion. */
+    uint64_t find;                      /* Total cycles finding. */
+    uint64_t delete;                    /* Total cycles deleting. */
+  };
+
+static void check_equivalence (void);
+static void check_same (struct hash *, struct chain *, size_t op);
+static void chain_init (struct chain *);
+static struct item *chain_find (struct chain *, const struct item *);
+static void chain_insert (struct chain *, struct item *);
+static void chain_remove (struct chain *, struct item *);
+static void bench_open (struct item *, size_t cnt);
+static void bench_chained (struct item *, size_t cnt);
+static void report (const char *name, size_t cnt, const struct times *);
+
+void
+test_bench_hash (void)
+{
+  size_t i, j;
+
+  check_equivalence ();
+
+  for (i = 0; i < SIZE_CNT; i++)
+    {
+      size_t cnt = sizes[i];
+      struct item *items = malloc (sizeof *items * cnt);
+      if (items == NULL)
+        fail ("out of memory allocating %zu items", cnt);
+      for (j = 0; j < cnt; j++)
+        items[j].key = 0x08048000 + j * PGSIZE;
+
+      bench_open (items, cnt);
+      bench_chained (items, cnt);
+      free (items);
+    }
+}
+
+/* Hash function for both tables. */
+static unsigned
+item_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int ((int) hash_entry (e, struct item, elem)->key);
+}
+
+/* Comparison function for both tables. */
+static bool
+item_less (const struct hash_elem *a, const struct hash_elem *b,
+           void *aux UNUSED)
+{
+  return (hash_entry (a, struct item, elem)->key
+          < hash_entry (b, struct item, elem)->key);
+}
+
+/* Applies the same random operations to an open-addressed and a
+   chained table and checks that they agree.  Each key has two
+   items, so that hash_replace() and hash_insert() of an item
+   whose key is already present have something to return.  The
+   first half of the run mostly adds elements and the second half
+   mostly removes them. */
+static void
+check_equivalence (void)
+{
+  static struct item a[CHECK_KEYS], b[CHECK_KEYS];
+  struct hash h;
+  struct chain c;
+  size_t i;
+
+  random_init (0x4a5b);
+  for (i = 0; i < CHECK_KEYS; i++)
+    a[i].key = b[i].key = 0x08048000 + i * PGSIZE;
+  if (!hash_init (&h, item_hash, item_less, NULL))
+    fail ("out of memory initializing hash table");
+  chain_init (&c);
+
+  for (i = 0; i < CHECK_OPS; i++)
+    {
+      size_t k = random_ulong () % CHECK_KEYS;
+      struct item *it = random_ulong () % 2 ? &a[k] : &b[k];
+      struct item *old = chain_find (&c, it);
+      struct hash_elem *expected = old != NULL ? &old->elem : NULL;
+      struct hash_elem *e;
+      int op = random_ulong () % 8;
+
+      if (i >= CHECK_OPS / 2)
+        op = (op + 4) % 8;
+      if (op < 4)
+        {
+          e = hash_insert (&h, &it->elem);
+          if (old == NULL)
+            chain_insert (&c, it);
+        }
+      else if (op == 4)
+        {
+          e = hash_replace (&h, &it->elem);
+          if (old != NULL)
+            chain_remove (&c, old);
+          chain_insert (&c, it);
+        }
+      else if (op == 5)
+        e = hash_find (&h, &it->elem);
+      else
+        {
+          e = hash_delete (&h, &it->elem);
+          if (old != NULL)
+            chain_remove (&c, old);
+        }
+
+      if (e != expected)
+        fail ("operation %zu on key %zu returned the wrong element", i, k);
+      if (i % 64 == 0)
+        check_same (&h, &c, i);
+    }
+  check_same (&h, &c, CHECK_OPS);
+
+  hash_destroy (&h, NULL);
+  free (c.buckets);
+  msg ("open table agreed with chained table over %d operations.",
+       CHECK_OPS);
+}
+
+/* Checks that H and C hold the same elements, after operation
+   OP. */
+static void
+check_same (struct hash *h, struct chain *c, size_t op)
+{
+  struct hash_iterator i;
+  size_t cnt = 0;
+
+  if (hash_size (h) != c->elem_cnt)
+    fail ("after operation %zu, open table has %zu elements, "
+          "chained table %zu", op, hash_size (h), c->elem_cnt);
+
+  for (hash_first (&i, h); hash_next (&i) != NULL; cnt++)
+    {
+      struct item *it = hash_entry (hash_cur (&i), struct item, elem);
+      if (chain_find (c, it) != it)
+        fail ("after operation %zu, open table has an element "
+              "that chained table does not", op);
+    }
+  if (cnt != c->elem_cnt)
+    fail ("after operation %zu, iteration visited %zu of %zu elements",
+          op, cnt, c->elem_cnt);
+}
+
+/* Times CNT ITEMS in the open-addressed hash table. */
+static void
+bench_open (struct item *items, size_t cnt)
+{
+  struct times t = {0, 0, 0, 0};
+  struct hash h;
+  uint64_t start;
+  size_t i;
+
+  if (!hash_init (&h, item_hash, item_less, NULL))
+    fail ("out of memory initializing hash table");
+
+  for (i = 0; i < cnt; i++)
+    {
+      uint64_t cycles;
+
+      start = timer_cycles ();
+      hash_insert (&h, &items[i].elem);
+      cycles = timer_cycles () - start;
+      t.insert += cycles;
+      if (cycles > t.insert_max)
+        t.insert_max = cycles;
+    }
+
+  start = timer_cycles ();
+  for (i = 0; i < cnt; i++)
+    {
+      struct item key;
+      key.key = items[i].key;
+      if (hash_find (&h, &key.elem) != &items[i].elem)
+        fail ("open table lost element %zu of %zu", i, cnt);
+    }
+  t.find = timer_cycles () - start;
+
+  start = timer_cycles ();
+  for (i = 0; i < cnt; i++)
+    if (hash_delete (&h, &items[i].elem) != &items[i].elem)
+      fail ("open table could not delete element %zu of %zu", i, cnt);
+  t.delete = timer_cycles () - start;
+
+  if (!hash_empty (&h))
+    fail ("open table not empty after deleting everything");
+  hash_destroy (&h, NULL);
+
+  report ("open", cnt, &t);
+}
+
+/* Returns the bucket in C that I belongs in. */
+static struct list *
+chain_bucket (struct chain *c, const struct item *i)
+{
+  return &c->buckets[c->hash (&i->elem, NULL) & (c->bucket_cnt - 1)];
+}
+
+/* Returns the item in C with the same key as I, or a null
+   pointer if there is none. */
+static struct item *
+chain_find (struct chain *c, const struct item *i)
+{
+  struct list *bucket = chain_bucket (c, i);
+  struct list_elem *e;
+
+  for (e = list_begin (bucket); e != list_end (bucket); e = list_next (e))
+    {
+      struct item *j = list_entry (e, struct item, chain_elem);
+      if (!c->less (&j->elem, &i->elem, NULL)
+          && !c->less (&i->elem, &j->elem, NULL))
+        return j;
+    }
+  return NULL;
+}
+
+/* Resizes C to one bucket per 2 elements, rounded down to a
+   power of 2, moving every element at once. */
+static void
+chain_rehash (struct chain *c)
+{
+  size_t old_bucket_cnt = c->bucket_cnt;
+  struct list *old_buckets = c->buckets;
+  size_t new_bucket_cnt = c->elem_cnt / 2;
+  size_t i;
+
+  if (new_bucket_cnt < 4)
+    new_bucket_cnt = 4;
+  while (new_bucket_cnt & (new_bucket_cnt - 1))
+    new_bucket_cnt &= new_bucket_cnt - 1;
+  if (new_bucket_cnt == old_bucket_cnt)
+    return;
+
+  c->buckets = malloc (sizeof *c->buckets * new_bucket_cnt);
+  if (c->buckets == NULL)
+    {
+      c->buckets = old_buckets;
+      return;
+    }
+  c->bucket_cnt = new_bucket_cnt;
+  for (i = 0; i < new_bucket_cnt; i++)
+    list_init (&c->buckets[i]);
+
+  for (i = 0; i < old_bucket_cnt; i++)
+    while (!list_empty (&old_buckets[i]))
+      {
+        struct list_elem *e = list_pop_front (&old_buckets[i]);
+        struct item *j = list_entry (e, struct item, chain_elem);
+        list_push_front (chain_bucket (c, j), e);
+      }
+  free (old_buckets);
+}
+
+/* Initializes C as an empty chained table. */
+static void
+chain_init (struct chain *c)
+{
+  size_t i;
+
+  c->elem_cnt = 0;
+  c->bucket_cnt = 4;
+  c->hash = item_hash;
+  c->less = item_less;
+  c->buckets = malloc (sizeof *c->buckets * c->bucket_cnt);
+  if (c->buckets == NULL)
+    fail ("out of memory initializing chained table");
+  for (i = 0; i < c->bucket_cnt; i++)
+    list_init (&c->buckets[i]);
+}
+
+/* Inserts I, whose key must not already be in C, into C. */
+static void
+chain_insert (struct chain *c, struct item *i)
+{
+  list_push_front (chain_bucket (c, i), &i->chain_elem);
+  c->elem_cnt++;
+  chain_rehash (c);
+}
+
+/* Removes I, which must be in C, from C. */
+static void
+chain_remove (struct chain *c, struct item *i)
+{
+  list_remove (&i->chain_elem);
+  c->elem_cnt--;
+  chain_rehash (c);
+}
+
+/* Times CNT ITEMS in the chained hash table. */
+static void
+bench_chained (struct item *items, size_t cnt)
+{
+  struct times t = {0, 0, 0, 0};
+  struct chain c;
+  uint64_t start;
+  size_t i;
+
+  chain_init (&c);
+
+  for (i = 0; i < cnt; i++)
+    {
+      uint64_t cycles;
+
+      start = timer_cycles ();
+      if (chain_find (&c, &items[i]) == NULL)
+        chain_insert (&c, &items[i]);
+      cycles = timer_cycles () - start;
+      t.insert += cycles;
+      if (cycles > t.insert_max)
+        t.insert_max = cycles;
+    }
+
+  start = timer_cycles ();
+  for (i = 0; i < cnt; i++)
+    {
+      struct item key;
+      key.key = items[i].key;
+      if (chain_find (&c, &key) != &items[i])
+        fail ("chained table lost element %zu of %zu", i, cnt);
+    }
+  t.find = timer_cycles () - start;
+
+  start = timer_cycles ();
+  for (i = 0; i < cnt; i++)
+    {
+      struct item *j = chain_find (&c, &items[i]);
+      if (j == NULL)
+        fail ("chained table could not delete element %zu of %zu", i, cnt);
+      chain_remove (&c, j);
+    }
+  t.delete = timer_cycles () - start;
+
+  free (c.buckets);
+
+  report ("chained", cnt, &t);
+}
+
+/* Reports times T for the table called NAME holding CNT
+   elements. */
+static void
+report (const char *name, size_t cnt, const struct times *t)
+{
+  msg ("%s %zu elements: %"PRIu64" cycles per insert (max %"PRIu64"), "
+       "%"PRIu64" per find, %"PRIu64" per delete.",
+       name, cnt, t->insert / cnt, t->insert_max, t->find / cnt,
+       t->delete / cnt);
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "open and chained tables disagreed\n"
+  if !grep (/^\(bench-hash\) open table agreed with chained table over \d+ operations\.$/,
+	    @output);
+
+# The timings vary, so just check that each one was reported.
+foreach my $table (qw (open chained)) {
+    foreach my $size (100, 1000, 10000) {
+	fail "$table table with $size elements missing\n"
+	  if !grep (/^\(bench-hash\) $table $size elements: \d+ cycles per insert \(max \d+\), \d+ per find, \d+ per delete\.$/,
+		    @output);
+    }
+}
+pass;
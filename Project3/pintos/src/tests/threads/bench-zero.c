@@ -0,0 +1,143 @@
+/* Measures PAL_ZERO page allocation with and without pages
+   zeroed ahead of time.  Dirties a batch of free kernel pages,
+   then times PAGE_CNT single-page PAL_ZERO requests, first with
+   the pool's zeroed pages refilled as the idle thread would,
+   then with palloc_zero_ahead turned off so that each request
+   clears its page itself, and reports the average CPU cycles per
+   page for each.
+
+   Fails unless every page handed out for PAL_ZERO is entirely
+   zero, and unless the user pool yields as many pages with its
+   zeroed list full as with it empty, that is, unless the zeroed
+   pages go back to the pool before an allocation fails. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define PAGE_CNT 16             /* Pages timed per measurement. */
+#define DIRTY_CNT 64            /* Pages dirtied before each one. */
+
+static void dirty_pages (void);
+static void refill_zeroed (void);
+static uint64_t time_zero_pages (void);
+static size_t count_user_pages (void);
+
+void
+test_bench_zero (void)
+{
+  uint64_t ahead, on_demand;
+  size_t cnt_empty, cnt_full;
+
+  palloc_zero_ahead = true;
+  dirty_pages ();
+  refill_zeroed ();
+  ahead = time_zero_pages ();
+
+  palloc_zero_ahead = false;
+  dirty_pages ();
+  on_demand = time_zero_pages ();
+
+  msg ("zero ahead: %"PRIu64" cycles per page.", ahead);
+  msg ("zero on demand: %"PRIu64" cycles per page.", on_demand);
+  msg ("all %d PAL_ZERO pages were zero.", 2 * PAGE_CNT);
+
+  /* Failed allocations take back the zeroed pages whether or not
+     zeroing ahead is on, so this also empties the zeroed list. */
+  cnt_empty = count_user_pages ();
+  palloc_zero_ahead = true;
+  refill_zeroed ();
+  cnt_full = count_user_pages ();
+  if (cnt_full != cnt_empty)
+    fail ("user pool gave %zu pages with zeroed pages set aside, "
+          "%zu without", cnt_full, cnt_empty);
+  msg ("user pool: zeroed pages given back when memory ran out.");
+}
+
+/* Fills DIRTY_CNT free kernel pages with nonzero bytes. */
+static void
+dirty_pages (void)
+{
+  void *pages[DIRTY_CNT];
+  int i;
+
+  for (i = 0; i < DIRTY_CNT; i++)
+    {
+      pages[i] = palloc_get_page (0);
+      if (pages[i] == NULL)
+        fail ("out of kernel pages");
+      memset (pages[i], 0x5a, PGSIZE);
+    }
+  for (i = 0; i < DIRTY_CNT; i++)
+    palloc_free_page (pages[i]);
+}
+
+/* Zeros free pages as the idle thread does, until both pools'
+   zeroed lists are full. */
+static void
+refill_zeroed (void)
+{
+  while (palloc_zero_idle ())
+    continue;
+}
+
+/* Allocates PAGE_CNT kernel pages with PAL_ZERO, checks that
+   each is zero, frees them, and returns the average number of
+   cycles per allocation. */
+static uint64_t
+time_zero_pages (void)
+{
+  uint8_t *pages[PAGE_CNT];
+  uint64_t start, cycles;
+  int i;
+
+  start = timer_cycles ();
+  for (i = 0; i < PAGE_CNT; i++)
+    pages[i] = palloc_get_page (PAL_ZERO);
+  cycles = timer_cycles () - start;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      size_t ofs;
+
+      if (pages[i] == NULL)
+        fail ("out of kernel pages");
+      for (ofs = 0; ofs < PGSIZE; ofs++)
+        if (pages[i][ofs] != 0)
+          fail ("page %d has byte %#x at offset %zu",
+                i, pages[i][ofs], ofs);
+    }
+  for (i = 0; i < PAGE_CNT; i++)
+    palloc_free_page (pages[i]);
+
+  return cycles / PAGE_CNT;
+}
+
+/* Allocates user pages until none are left, frees them all, and
+   returns how many there were. */
+static size_t
+count_user_pages (void)
+{
+  void *head = NULL;
+  void *page;
+  size_t cnt = 0;
+
+  while ((page = palloc_get_page (PAL_USER)) != NULL)
+    {
+      *(void **) page = head;
+      head = page;
+      cnt++;
+    }
+  while (head != NULL)
+    {
+      page = head;
+      head = *(void **) page;
+      palloc_free_page (page);
+    }
+  return cnt;
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# The timings vary, but the checks behind the last two lines do not.
+fail "pre-zeroed timing missing\n"
+  if !grep (/^\(bench-zero\) zero ahead: \d+ cycles per page\.$/, @output);
+fail "on-demand timing missing\n"
+  if !grep (/^\(bench-zero\) zero on demand: \d+ cycles per page\.$/, @output);
+fail "zero check missing\n"
+  if !grep (/^\(bench-zero\) all \d+ PAL_ZERO pages were zero\.$/, @output);
+fail "reclaim check missing\n"
+  if !grep (/^\(bench-zero\) user pool: zeroed pages given back when memory ran out\.$/,
+	    @output);
+pass;
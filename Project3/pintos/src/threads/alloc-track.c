@@ -0,0 +1,170 @@
+#include "threads/alloc-track.h"
+#ifdef ALLOC_TRACK
+#include <debug.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+
+/* Allocation tracking.
+
+   Call sites are kept in a fixed-size hash table, keyed on the
+   caller's address and the kind of allocation, with linear
+   probing.  Sites are never removed, so a site's index stays
+   valid for as long as the memory allocated there, and the
+   allocators store it alongside each allocation to charge the
+   free back to the right site.  The first ALLOC_KIND_CNT slots
+   are never hashed to: each collects the allocations of its kind
+   from any sites that do not fit.
+
+   The tables are updated with interrupts off, which is cheaper
+   than a lock and lets the page allocator be tracked no matter
+   what context it is called in. */
+
+#define SITE_CNT 512            /* Number of sites; a power of 2. */
+#define SITE_TOP 20             /* Number of sites reported. */
+
+/* A call site. */
+struct alloc_site
+  {
+    void *caller;               /* Return address, null if unused. */
+    enum alloc_kind kind;       /* Kind of allocation. */
+    unsigned alloc_cnt;         /* Allocations ever made. */
+    unsigned live_cnt;          /* Allocations not yet freed. */
+    size_t live_bytes;          /* Bytes not yet freed. */
+    size_t peak_bytes;          /* Most bytes ever live at once. */
+  };
+
+static struct alloc_site sites[SITE_CNT];
+
+/* Totals over all sites of each kind. */
+static size_t live_bytes[ALLOC_KIND_CNT];
+static size_t peak_bytes[ALLOC_KIND_CNT];
+
+static const char *kind_names[ALLOC_KIND_CNT] =
+  { "malloc", "kernel pages", "user pages" };
+
+/* Returns the index of the site for allocations of KIND from
+   CALLER, adding it if necessary. */
+static unsigned
+find_site (enum alloc_kind kind, void *caller)
+{
+  unsigned idx = (((uintptr_t) caller >> 2) ^ kind) & (SITE_CNT - 1);
+  unsigned i;
+
+  for (i = 0; i < SITE_CNT; i++, idx = (idx + 1) & (SITE_CNT - 1))
+    {
+      struct alloc_site *s = &sites[idx];
+      if (idx < ALLOC_KIND_CNT)
+        continue;
+      if (s->caller == caller && s->kind == kind)
+        return idx;
+      if (s->caller == NULL)
+        {
+          s->caller = caller;
+          s->kind = kind;
+          return idx;
+        }
+    }
+
+  /* The table is full. */
+  sites[kind].kind = kind;
+  return kind;
+}
+
+/* Records an allocation of BYTES bytes of KIND made from CALLER
+   and returns the index of its site, to be passed to
+   alloc_track_free() when it is freed. */
+unsigned
+alloc_track_alloc (enum alloc_kind kind, void *caller, size_t bytes)
+{
+  enum intr_level old_level;
+  struct alloc_site *s;
+  unsigned idx;
+
+  ASSERT (kind < ALLOC_KIND_CNT);
+
+  old_level = intr_disable ();
+  idx = find_site (kind, caller);
+  s = &sites[idx];
+  s->alloc_cnt++;
+  s->live_cnt++;
+  s->live_bytes += bytes;
+  if (s->live_bytes > s->peak_bytes)
+    s->peak_bytes = s->live_bytes;
+  live_bytes[kind] += bytes;
+  if (live_bytes[kind] > peak_bytes[kind])
+    peak_bytes[kind] = live_bytes[kind];
+  intr_set_level (old_level);
+
+  return idx;
+}
+
+/* Records that BYTES bytes allocated at site SITE have been
+   freed. */
+void
+alloc_track_free (unsigned site, size_t bytes)
+{
+  enum intr_level old_level;
+  struct alloc_site *s;
+
+  ASSERT (site < SITE_CNT);
+
+  old_level = intr_disable ();
+  s = &sites[site];
+  ASSERT (s->live_cnt > 0 && s->live_bytes >= bytes);
+  s->live_cnt--;
+  s->live_bytes -= bytes;
+  live_bytes[s->kind] -= bytes;
+  intr_set_level (old_level);
+}
+
+/* Prints the totals for each kind of allocation, then the
+   SITE_TOP sites with the most live bytes, then their addresses
+   on one line in a form that utils/backtrace accepts. */
+void
+alloc_track_print (void)
+{
+  bool printed[SITE_CNT];
+  void *callers[SITE_TOP];
+  int caller_cnt = 0;
+  int i, j;
+
+  printf ("Allocations:");
+  for (i = 0; i < ALLOC_KIND_CNT; i++)
+    printf ("%s %zu bytes of %s live (peak %zu)",
+            i > 0 ? "," : "", live_bytes[i], kind_names[i], peak_bytes[i]);
+  printf ("\n");
+
+  for (i = 0; i < SITE_CNT; i++)
+    printed[i] = false;
+  for (i = 0; i < SITE_TOP; i++)
+    {
+      struct alloc_site *s;
+      int best = -1;
+
+      for (j = 0; j < SITE_CNT; j++)
+        if (sites[j].alloc_cnt > 0 && !printed[j]
+            && (best < 0 || sites[j].live_bytes > sites[best].live_bytes))
+          best = j;
+      if (best < 0 || sites[best].live_bytes == 0)
+        break;
+      printed[best] = true;
+
+      s = &sites[best];
+      printf ("  %p %s: %u live, %zu bytes (peak %zu), %u allocs\n",
+              s->caller, kind_names[s->kind], s->live_cnt,
+              s->live_bytes, s->peak_bytes, s->alloc_cnt);
+      if (s->caller != NULL)
+        callers[caller_cnt++] = s->caller;
+    }
+
+  if (caller_cnt > 0)
+    {
+      printf ("Alloc sites:");
+      for (i = 0; i < caller_cnt; i++)
+        printf (" %p", callers[i]);
+      printf (".\n");
+    }
+}
+#endif /* ALLOC_TRACK */
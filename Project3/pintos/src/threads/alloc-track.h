@@ -0,0 +1,38 @@
+#ifndef THREADS_ALLOC_TRACK_H
+#define THREADS_ALLOC_TRACK_H
+
+#include <stddef.h>
+
+/* Allocation tracking.
+
+   If the kernel is built with -DALLOC_TRACK, malloc() and the
+   page allocator attribute every allocation to the address it
+   was called from, keeping for each such call site the number of
+   bytes it has allocated that are still live and the most that
+   ever were.  alloc_track_print() reports the sites holding the
+   most memory; pass the addresses it prints to utils/backtrace
+   to find out which functions they are in.
+
+   Tracking costs a table lookup with interrupts off per
+   allocation and per free, plus an 8-byte header on each
+   malloc() block, so it can be left on for long runs.  Without
+   -DALLOC_TRACK it is compiled out entirely. */
+
+/* Kinds of allocation. */
+enum alloc_kind
+  {
+    ALLOC_MALLOC,               /* malloc(), calloc(), realloc(). */
+    ALLOC_KERNEL_PAGE,          /* Pages from the kernel pool. */
+    ALLOC_USER_PAGE,            /* Pages from the user pool. */
+    ALLOC_KIND_CNT              /* Number of kinds. */
+  };
+
+#ifdef ALLOC_TRACK
+unsigned alloc_track_alloc (enum alloc_kind, void *caller, size_t bytes);
+void alloc_track_free (unsigned site, size_t bytes);
+void alloc_track_print (void);
+#else
+static inline void alloc_track_print (void) { }
+#endif
+
+#endif /* threads/alloc-track.h */
@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/alloc-track.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -32,7 +33,11 @@
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.
+
+   If allocations are being tracked (see alloc-track.h), each
+   block handed out starts with a hidden `struct track_header'
+   that records how big it is and where it came from. */
 
 /* Descriptor. */
 struct desc
@@ -64,6 +69,22 @@ struct block
 static struct desc descs[10];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+#ifdef ALLOC_TRACK
+/* Magic number for detecting corrupted tracking headers. */
+#define TRACK_MAGIC 0x7ac4
+
+/* Header in front of each tracked block. */
+struct track_header
+  {
+    uint16_t magic;             /* Always set to TRACK_MAGIC. */
+    uint16_t site;              /* Allocation site. */
+    uint32_t size;              /* Size requested. */
+  };
+#endif
+
+static void *malloc_from (size_t size, void *caller);
+static void *block_alloc (size_t size);
+static void block_free (void *);
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
 
@@ -88,6 +109,38 @@ malloc_init (void)
    Returns a null pointer if memory is not available. */
 void *
 malloc (size_t size) 
+{
+  return malloc_from (size, __builtin_return_address (0));
+}
+
+/* Obtains and returns a new block of at least SIZE bytes on
+   behalf of CALLER.  Returns a null pointer if memory is not
+   available. */
+static void *
+malloc_from (size_t size, void *caller UNUSED) 
+{
+#ifdef ALLOC_TRACK
+  struct track_header *h;
+
+  if (size == 0 || size > UINT32_MAX - sizeof *h)
+    return NULL;
+  h = block_alloc (size + sizeof *h);
+  if (h == NULL)
+    return NULL;
+  h->magic = TRACK_MAGIC;
+  h->site = alloc_track_alloc (ALLOC_MALLOC, caller, size);
+  h->size = size;
+  return h + 1;
+#else
+  return block_alloc (size);
+#endif
+}
+
+/* Obtains and returns a new block of at least SIZE bytes from
+   the arenas.  Returns a null pointer if memory is not
+   available. */
+static void *
+block_alloc (size_t size) 
 {
   struct desc *d;
   struct block *b;
@@ -167,7 +220,7 @@ calloc (size_t a, size_t b)
     return NULL;
 
   /* Allocate and zero memory. */
-  p = malloc (size);
+  p = malloc_from (size, __builtin_return_address (0));
   if (p != NULL)
     memset (p, 0, size);
 
@@ -178,11 +231,17 @@ calloc (size_t a, size_t b)
 static size_t
 block_size (void *block) 
 {
+#ifdef ALLOC_TRACK
+  struct track_header *h = (struct track_header *) block - 1;
+  ASSERT (h->magic == TRACK_MAGIC);
+  return h->size;
+#else
   struct block *b = block;
   struct arena *a = block_to_arena (b);
   struct desc *d = a->desc;
 
   return d != NULL ? d->block_size : PGSIZE * a->free_cnt - pg_ofs (block);
+#endif
 }
 
 /* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
@@ -201,7 +260,7 @@ realloc (void *old_block, size_t new_size)
     }
   else 
     {
-      void *new_block = malloc (new_size);
+      void *new_block = malloc_from (new_size, __builtin_return_address (0));
       if (old_block != NULL && new_block != NULL)
         {
           size_t old_size = block_size (old_block);
@@ -217,6 +276,22 @@ realloc (void *old_block, size_t new_size)
    malloc(), calloc(), or realloc(). */
 void
 free (void *p) 
+{
+#ifdef ALLOC_TRACK
+  if (p != NULL)
+    {
+      struct track_header *h = (struct track_header *) p - 1;
+      ASSERT (h->magic == TRACK_MAGIC);
+      alloc_track_free (h->site, h->size);
+      p = h;
+    }
+#endif
+  block_free (p);
+}
+
+/* Returns block P, obtained from block_alloc(), to its arena. */
+static void
+block_free (void *p) 
 {
   if (p != NULL)
     {
@@ -2,11 +2,14 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/alloc-track.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -23,7 +26,20 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool also keeps a list of up to ZEROED_MAX single pages
+   that the idle thread has already filled with zeros (see
+   palloc_zero_idle()), so that a PAL_ZERO request for one page,
+   such as a new thread, a file descriptor table, a page table or
+   a zero-filled user page at fault time, need not clear it while
+   the caller waits.  These pages are marked in use in `used_map'
+   and belong to nobody.  Only the list element at the start of
+   each one is not zero.  The idle thread adds to the list without
+   holding the pool's lock, so the list is protected by turning
+   interrupts off instead.  If the bitmap runs short, the zeroed
+   pages are given back to it before an allocation fails. */
+#define ZEROED_MAX 32                   /* Zeroed pages kept per pool. */
 
 /* A memory pool. */
 struct pool
@@ -31,14 +47,28 @@ struct pool
     struct lock lock;                   /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
     uint8_t *base;                      /* Base of pool. */
+#ifdef ALLOC_TRACK
+    uint16_t *sites;                    /* Allocation site of each page. */
+#endif
+    struct list zeroed;                 /* Pages already zeroed. */
+    size_t zeroed_cnt;                  /* Number of pages in `zeroed'. */
   };
 
+/* If true (default), PAL_ZERO requests for one page take pages
+   zeroed ahead of time by the idle thread.  If false, every
+   PAL_ZERO request clears its pages itself and the idle thread
+   zeros nothing. */
+bool palloc_zero_ahead = true;
+
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static void *get_pages (enum palloc_flags, size_t page_cnt, void *caller);
+static size_t zeroed_pop (struct pool *);
+static bool reclaim_zeroed (struct pool *);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -69,17 +99,50 @@ palloc_init (size_t user_page_limit)
    FLAGS, in which case the kernel panics. */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
+{
+  return get_pages (flags, page_cnt, __builtin_return_address (0));
+}
+
+/* Obtains a single free page and returns its kernel virtual
+   address.
+   If PAL_USER is set, the page is obtained from the user pool,
+   otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
+   then the page is filled with zeros.  If no pages are
+   available, returns a null pointer, unless PAL_ASSERT is set in
+   FLAGS, in which case the kernel panics. */
+void *
+palloc_get_page (enum palloc_flags flags) 
+{
+  return get_pages (flags, 1, __builtin_return_address (0));
+}
+
+/* Obtains PAGE_CNT contiguous free pages on behalf of CALLER, as
+   for palloc_get_multiple(). */
+static void *
+get_pages (enum palloc_flags flags, size_t page_cnt, void *caller UNUSED)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
   void *pages;
-  size_t page_idx;
+  size_t page_idx = BITMAP_ERROR;
+  bool zeroed = false;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  if ((flags & PAL_ZERO) && page_cnt == 1 && palloc_zero_ahead) 
+    {
+      /* Prefer a page zeroed ahead of time. */
+      page_idx = zeroed_pop (pool);
+      zeroed = page_idx != BITMAP_ERROR;
+    }
+  if (page_idx == BITMAP_ERROR) 
+    {
+      lock_acquire (&pool->lock);
+      page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+      if (page_idx == BITMAP_ERROR && reclaim_zeroed (pool))
+        page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+      lock_release (&pool->lock);
+    }
 
   if (page_idx != BITMAP_ERROR)
     pages = pool->base + PGSIZE * page_idx;
@@ -88,31 +151,29 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 
   if (pages != NULL) 
     {
-      if (flags & PAL_ZERO)
+#ifdef ALLOC_TRACK
+      pool->sites[page_idx] = alloc_track_alloc (pool == &user_pool
+                                                 ? ALLOC_USER_PAGE
+                                                 : ALLOC_KERNEL_PAGE,
+                                                 caller, PGSIZE * page_cnt);
+#endif
+      if (zeroed)
+        memset (pages, 0, sizeof (struct list_elem));
+      else if (flags & PAL_ZERO)
         memset (pages, 0, PGSIZE * page_cnt);
     }
   else 
     {
-      if (flags & PAL_ASSERT)
-        PANIC ("palloc_get: out of pages");
+      if (flags & PAL_ASSERT) 
+        {
+          alloc_track_print ();
+          PANIC ("palloc_get: out of pages");
+        }
     }
 
   return pages;
 }
 
-/* Obtains a single free page and returns its kernel virtual
-   address.
-   If PAL_USER is set, the page is obtained from the user pool,
-   otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
-   then the page is filled with zeros.  If no pages are
-   available, returns a null pointer, unless PAL_ASSERT is set in
-   FLAGS, in which case the kernel panics. */
-void *
-palloc_get_page (enum palloc_flags flags) 
-{
-  return palloc_get_multiple (flags, 1);
-}
-
 /* Frees the PAGE_CNT pages starting at PAGES. */
 void
 palloc_free_multiple (void *pages, size_t page_cnt) 
@@ -137,6 +198,10 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
+#ifdef ALLOC_TRACK
+  alloc_track_free (pool->sites[page_idx], PGSIZE * page_cnt);
+#endif
+
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
   bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
 }
@@ -156,7 +221,14 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
   /* We'll put the pool's used_map at its base.
      Calculate the space needed for the bitmap
      and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
+  size_t bm_size = bitmap_buf_size (page_cnt);
+  size_t bm_pages;
+#ifdef ALLOC_TRACK
+  /* Put the allocation site of each page after it. */
+  bm_pages = DIV_ROUND_UP (bm_size + page_cnt * sizeof *p->sites, PGSIZE);
+#else
+  bm_pages = DIV_ROUND_UP (bm_size, PGSIZE);
+#endif
   if (bm_pages > page_cnt)
     PANIC ("Not enough memory in %s for bitmap.", name);
   page_cnt -= bm_pages;
@@ -165,8 +237,13 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
 
   /* Initialize the pool. */
   lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
+  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_size);
   p->base = base + bm_pages * PGSIZE;
+#ifdef ALLOC_TRACK
+  p->sites = (uint16_t *) ((uint8_t *) base + bm_size);
+#endif
+  list_init (&p->zeroed);
+  p->zeroed_cnt = 0;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -180,3 +257,87 @@ page_from_pool (const struct pool *pool, void *page)
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Removes a page from POOL's list of zeroed pages and returns
+   its index, or BITMAP_ERROR if the list is empty.  The page
+   stays marked in use in POOL's bitmap. */
+static size_t
+zeroed_pop (struct pool *pool) 
+{
+  struct list_elem *e = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (!list_empty (&pool->zeroed)) 
+    {
+      e = list_pop_front (&pool->zeroed);
+      pool->zeroed_cnt--;
+    }
+  intr_set_level (old_level);
+
+  return e != NULL ? pg_no (e) - pg_no (pool->base) : BITMAP_ERROR;
+}
+
+/* Marks all of POOL's zeroed pages free in its bitmap.  Returns
+   true if there were any, false otherwise.  POOL's lock must be
+   held. */
+static bool
+reclaim_zeroed (struct pool *pool) 
+{
+  size_t page_idx;
+
+  ASSERT (lock_held_by_current_thread (&pool->lock));
+
+  if (pool->zeroed_cnt == 0)
+    return false;
+  while ((page_idx = zeroed_pop (pool)) != BITMAP_ERROR)
+    bitmap_reset (pool->used_map, page_idx);
+  return true;
+}
+
+/* Zeros one free page of POOL and adds it to POOL's list of
+   zeroed pages, if that list is short and POOL's lock is free.
+   Returns true if a page was zeroed, false otherwise. */
+static bool
+zero_one (struct pool *pool) 
+{
+  enum intr_level old_level;
+  size_t page_idx = BITMAP_ERROR;
+  struct list_elem *e;
+
+  if (!palloc_zero_ahead || pool->zeroed_cnt >= ZEROED_MAX)
+    return false;
+
+  /* The idle thread must not sleep on the lock, or be preempted
+     while holding it, so only take the lock if it is free and
+     keep interrupts off while holding it. */
+  old_level = intr_disable ();
+  if (lock_try_acquire (&pool->lock)) 
+    {
+      page_idx = bitmap_scan_and_flip (pool->used_map, 0, 1, false);
+      lock_release (&pool->lock);
+    }
+  intr_set_level (old_level);
+  if (page_idx == BITMAP_ERROR)
+    return false;
+
+  e = (struct list_elem *) (pool->base + PGSIZE * page_idx);
+  memset (e, 0, PGSIZE);
+
+  old_level = intr_disable ();
+  list_push_front (&pool->zeroed, e);
+  pool->zeroed_cnt++;
+  intr_set_level (old_level);
+  return true;
+}
+
+/* Zeros one free page, for later PAL_ZERO requests, if either
+   pool is short of zeroed pages.  Returns true if a page was
+   zeroed, false if there was nothing to do.  Called by the idle
+   thread, with interrupts on, so that whatever becomes ready in
+   the meantime can preempt it as usual. */
+bool
+palloc_zero_idle (void) 
+{
+  return zero_one (&kernel_pool) || zero_one (&user_pool);
+}
@@ -0,0 +1,304 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Slab allocator.
+
+   Each slab is a single page.  It begins with a `struct slab'
+   header, followed by an array of free-list links, one per
+   object, and then, starting on a cache line boundary, the
+   objects themselves.  Free objects are chained through the
+   link array by index rather than through the objects, so a
+   free object keeps whatever its constructor put in it and a
+   cache with a constructor only runs it once per object, when
+   its slab is created.
+
+   The bytes left over at the end of a slab are used to "color"
+   it: successive slabs start their objects at successive cache
+   line offsets, so that the first objects of many slabs do not
+   all compete for the same cache sets.
+
+   A cache keeps its slabs on three lists, according to whether
+   they are partly used, full, or unused.  Allocation prefers
+   partly used slabs, to keep the number of slabs down.  A cache
+   keeps at most one unused slab around and gives any others back
+   to the page allocator. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Free-list link marking the end of a slab's free list. */
+#define SLAB_END UINT16_MAX
+
+/* Slab header, at the start of each slab's page. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct kmem_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in one of cache's lists. */
+    uint8_t *objs;              /* First object. */
+    uint16_t inuse_cnt;         /* Number of objects in use. */
+    uint16_t free;              /* First free object, or SLAB_END. */
+    uint16_t next[];            /* Next free object after each one. */
+  };
+
+/* All the caches, for statistics. */
+static struct list all_caches = LIST_INITIALIZER (all_caches);
+
+static struct slab *slab_create (struct kmem_cache *);
+static struct slab *obj_to_slab (struct kmem_cache *, void *);
+
+/* Returns the offset of the first object within a slab, before
+   coloring, if each slab holds OBJ_CNT objects. */
+static size_t
+objs_offset (size_t obj_cnt)
+{
+  return ROUND_UP (sizeof (struct slab) + obj_cnt * sizeof (uint16_t),
+                   CACHE_LINE_SIZE);
+}
+
+/* Initializes CACHE to hand out objects of SIZE bytes each,
+   aligned on a multiple of ALIGN bytes, which must be a power of
+   2 no greater than CACHE_LINE_SIZE, or 0 for the alignment of a
+   pointer.  Each object is initialized by CTOR, if it is
+   nonnull, when it is first created, and it must be returned to
+   the cache in the same state.  NAME identifies the cache in
+   statistics. */
+void
+kmem_cache_init (struct kmem_cache *cache, const char *name,
+                 size_t size, size_t align, void (*ctor) (void *))
+{
+  size_t obj_cnt;
+  enum intr_level old_level;
+
+  if (align == 0)
+    align = sizeof (void *);
+  ASSERT (cache != NULL);
+  ASSERT (size > 0);
+  ASSERT (align <= CACHE_LINE_SIZE && (align & (align - 1)) == 0);
+
+  cache->name = name;
+  cache->obj_size = size;
+  cache->slot_size = ROUND_UP (size, align);
+  cache->ctor = ctor;
+
+  /* Fit as many objects into a page as possible. */
+  obj_cnt = (PGSIZE - sizeof (struct slab)) / (cache->slot_size
+                                               + sizeof (uint16_t));
+  while (obj_cnt > 0
+         && objs_offset (obj_cnt) + obj_cnt * cache->slot_size > PGSIZE)
+    obj_cnt--;
+  if (obj_cnt == 0)
+    PANIC ("%s: %zu-byte objects are too big for a slab", name, size);
+  if (obj_cnt > SLAB_END)
+    obj_cnt = SLAB_END;
+  cache->objs_per_slab = obj_cnt;
+  cache->color_cnt = (PGSIZE - objs_offset (obj_cnt)
+                      - obj_cnt * cache->slot_size) / CACHE_LINE_SIZE + 1;
+  cache->next_color = 0;
+
+  lock_init (&cache->lock);
+  list_init (&cache->partial);
+  list_init (&cache->full);
+  list_init (&cache->empty);
+  cache->alloc_cnt = cache->free_cnt = 0;
+  cache->slab_cnt = cache->inuse_cnt = cache->peak_cnt = 0;
+
+  old_level = intr_disable ();
+  list_push_back (&all_caches, &cache->elem);
+  intr_set_level (old_level);
+}
+
+/* Obtains and returns an object from CACHE.  Returns a null
+   pointer if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *cache)
+{
+  struct slab *s;
+  uint8_t *obj;
+
+  lock_acquire (&cache->lock);
+  if (!list_empty (&cache->partial))
+    s = list_entry (list_front (&cache->partial), struct slab, elem);
+  else if (!list_empty (&cache->empty))
+    {
+      s = list_entry (list_pop_front (&cache->empty), struct slab, elem);
+      list_push_front (&cache->partial, &s->elem);
+    }
+  else
+    {
+      /* Make a new slab, without holding the lock while running
+         constructors. */
+      lock_release (&cache->lock);
+      s = slab_create (cache);
+      if (s == NULL)
+        return NULL;
+      lock_acquire (&cache->lock);
+      cache->slab_cnt++;
+      list_push_front (&cache->partial, &s->elem);
+    }
+
+  /* Take the first free object. */
+  ASSERT (s->free != SLAB_END);
+  obj = s->objs + s->free * cache->slot_size;
+  s->free = s->next[s->free];
+  if (++s->inuse_cnt == cache->objs_per_slab)
+    {
+      list_remove (&s->elem);
+      list_push_front (&cache->full, &s->elem);
+    }
+
+  cache->alloc_cnt++;
+  if (++cache->inuse_cnt > cache->peak_cnt)
+    cache->peak_cnt = cache->inuse_cnt;
+  lock_release (&cache->lock);
+
+  return obj;
+}
+
+/* Obtains an object from CACHE, fills it with zeros, and returns
+   it.  Returns a null pointer if memory is not available.  Only
+   makes sense for a cache without a constructor. */
+void *
+kmem_cache_zalloc (struct kmem_cache *cache)
+{
+  void *obj;
+
+  ASSERT (cache->ctor == NULL);
+
+  obj = kmem_cache_alloc (cache);
+  if (obj != NULL)
+    memset (obj, 0, cache->obj_size);
+  return obj;
+}
+
+/* Returns OBJ, which must have been obtained from CACHE, to
+   CACHE.  Does nothing if OBJ is a null pointer. */
+void
+kmem_cache_free (struct kmem_cache *cache, void *obj)
+{
+  struct slab *s;
+  size_t idx;
+  void *page = NULL;
+
+  if (obj == NULL)
+    return;
+
+  s = obj_to_slab (cache, obj);
+  idx = ((uint8_t *) obj - s->objs) / cache->slot_size;
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs, unless
+     its constructed state has to survive. */
+  if (cache->ctor == NULL)
+    memset (obj, 0xcc, cache->obj_size);
+#endif
+
+  lock_acquire (&cache->lock);
+  ASSERT (s->inuse_cnt > 0);
+
+  /* Put the object back on the slab's free list, and move the
+     slab to the right list for its new state. */
+  s->next[idx] = s->free;
+  s->free = idx;
+  if (s->inuse_cnt-- == cache->objs_per_slab)
+    {
+      list_remove (&s->elem);
+      list_push_front (&cache->partial, &s->elem);
+    }
+  if (s->inuse_cnt == 0)
+    {
+      list_remove (&s->elem);
+      if (list_empty (&cache->empty))
+        list_push_front (&cache->empty, &s->elem);
+      else
+        {
+          cache->slab_cnt--;
+          page = s;
+        }
+    }
+
+  cache->free_cnt++;
+  cache->inuse_cnt--;
+  lock_release (&cache->lock);
+
+  if (page != NULL)
+    palloc_free_page (page);
+}
+
+/* Prints statistics for each cache that has been used. */
+void
+kmem_cache_print_stats (void)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&all_caches); e != list_end (&all_caches);
+       e = list_next (e))
+    {
+      struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+      if (c->alloc_cnt == 0)
+        continue;
+      printf ("Slab %s: %zu-byte objects, %zu per slab, %zu slabs, "
+              "%zu in use (peak %zu), %llu allocs, %llu frees\n",
+              c->name, c->slot_size, c->objs_per_slab, c->slab_cnt,
+              c->inuse_cnt, c->peak_cnt, c->alloc_cnt, c->free_cnt);
+    }
+}
+
+/* Obtains a page for a new slab for CACHE, constructs all of its
+   objects, and returns it.  Returns a null pointer if memory is
+   not available. */
+static struct slab *
+slab_create (struct kmem_cache *cache)
+{
+  struct slab *s;
+  size_t color;
+  size_t i;
+
+  s = palloc_get_page (0);
+  if (s == NULL)
+    return NULL;
+
+  lock_acquire (&cache->lock);
+  color = cache->next_color;
+  cache->next_color = (color + 1) % cache->color_cnt;
+  lock_release (&cache->lock);
+
+  s->magic = SLAB_MAGIC;
+  s->cache = cache;
+  s->objs = (uint8_t *) s + objs_offset (cache->objs_per_slab)
+            + color * CACHE_LINE_SIZE;
+  s->inuse_cnt = 0;
+  s->free = 0;
+  for (i = 0; i < cache->objs_per_slab; i++)
+    {
+      s->next[i] = i + 1 < cache->objs_per_slab ? i + 1 : SLAB_END;
+      if (cache->ctor != NULL)
+        cache->ctor (s->objs + i * cache->slot_size);
+    }
+  return s;
+}
+
+/* Returns the slab that OBJ, from CACHE, is inside. */
+static struct slab *
+obj_to_slab (struct kmem_cache *cache, void *obj)
+{
+  struct slab *s = pg_round_down (obj);
+
+  /* Check that the slab is valid. */
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == cache);
+
+  /* Check that the object is properly aligned for the slab. */
+  ASSERT ((uint8_t *) obj >= s->objs);
+  ASSERT (((uint8_t *) obj - s->objs) % cache->slot_size == 0);
+  ASSERT (((uint8_t *) obj - s->objs) / cache->slot_size
+          < cache->objs_per_slab);
+
+  return s;
+}
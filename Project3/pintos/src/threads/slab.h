@@ -0,0 +1,52 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/synch.h"
+
+/* Size of a CPU cache line, in bytes. */
+#define CACHE_LINE_SIZE 64
+
+/* Object cache.
+
+   A cache hands out objects of a single type from "slabs", pages
+   obtained from the page allocator and cut into equal slots of
+   exactly the object's size (rounded up to its alignment), so
+   that a type whose size falls just above a power of 2 does not
+   waste almost half of each malloc() block.  See slab.c for
+   details. */
+struct kmem_cache
+  {
+    const char *name;           /* Name, for statistics. */
+    size_t obj_size;            /* Object size requested. */
+    size_t slot_size;           /* Object size rounded up to alignment. */
+    size_t objs_per_slab;       /* Number of objects in each slab. */
+    size_t color_cnt;           /* Number of different slab offsets. */
+    size_t next_color;          /* Offset to use for next slab. */
+    void (*ctor) (void *);      /* Constructor, or a null pointer. */
+
+    struct lock lock;           /* Protects the members below. */
+    struct list partial;        /* Slabs with both used and free slots. */
+    struct list full;           /* Slabs with no free slots. */
+    struct list empty;          /* Slabs with no used slots. */
+
+    /* Statistics. */
+    unsigned long long alloc_cnt;       /* Objects allocated. */
+    unsigned long long free_cnt;        /* Objects freed. */
+    size_t slab_cnt;                    /* Slabs now held. */
+    size_t inuse_cnt;                   /* Objects now in use. */
+    size_t peak_cnt;                    /* Most objects ever in use. */
+
+    struct list_elem elem;      /* Element in list of all caches. */
+  };
+
+void kmem_cache_init (struct kmem_cache *, const char *name,
+                      size_t size, size_t align, void (*ctor) (void *));
+void *kmem_cache_alloc (struct kmem_cache *);
+void *kmem_cache_zalloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *);
+void kmem_cache_print_stats (void);
+
+#endif /* threads/slab.h */
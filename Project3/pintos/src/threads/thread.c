@@ -224,7 +224,7 @@ thread_create (const char *name, int priority,
 
   /* For file descriptor */
   /* Initialize variable for file descriptor */
-  t->fd_table = palloc_get_page(0);
+  t->fd_table = palloc_get_page(PAL_ZERO);
   t->fd_next = 2;
   
   /* Add to run queue. */
@@ -437,6 +437,17 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
+      /* Zero free pages ahead of PAL_ZERO requests while there is
+         nothing else to do.  Interrupts are on meanwhile, so
+         devices keep being serviced, and we stop as soon as a
+         thread becomes ready. */
+      intr_enable ();
+      while (list_empty (&ready_list) && palloc_zero_idle ())
+        continue;
+      intr_disable ();
+      if (!list_empty (&ready_list))
+        continue;
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -514,7 +514,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       
       /* For virtual memory */
       /* Allocate vm_entry */
-      vm_e = malloc(sizeof(struct vm_entry));
+      vm_e = alloc_vme();
       if (vm_e == NULL) 
         return false;
 
@@ -564,7 +564,7 @@ setup_stack (void **esp)
     }
   /* For virtual memory */
   /* Allocate vm_entry */
-  vm_e = malloc(sizeof(struct vm_entry));
+  vm_e = alloc_vme();
   if (vm_e == NULL) 
     return false;
 
@@ -729,8 +729,11 @@ process_close_file (int fd)
 bool 
 handle_mm_fault (struct vm_entry *vme)
 {
+  /* Pages with nothing to read from a file are all zeros, which
+     the page allocator can often provide without waiting */
+  bool zero_fill = vme->type == VM_ANON || vme->read_bytes == 0;
   /* Allocate physical memory */
-  uint8_t *kaddr = palloc_get_page(PAL_USER);
+  uint8_t *kaddr = palloc_get_page(PAL_USER | (zero_fill ? PAL_ZERO : 0));
   /* Check whether vme is already loaded or not */
   if(vme->is_loaded == true)
     return false;
@@ -742,7 +745,7 @@ handle_mm_fault (struct vm_entry *vme)
   {
     /* Load the file */
     case VM_BIN:
-    if(load_file(kaddr, vme)!=true)
+    if(!zero_fill && load_file(kaddr, vme)!=true)
     {
       palloc_free_page(kaddr);
       return false;
@@ -22,16 +22,22 @@
 #include "userprog/pagedir.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "lib/kernel/list.h"
 #include <string.h>
 
 static void syscall_handler (struct intr_frame *);
 
+/* For slab allocation */
+static struct kmem_cache mmap_cache;    /* Cache of mmap_file */
+
 void
 syscall_init (void) 
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
   lock_init (&filesys_lock);
+  kmem_cache_init (&mmap_cache, "mmap_file", sizeof (struct mmap_file), 0,
+                   NULL);
 }
 
 static void
@@ -432,7 +438,7 @@ mmap (int fd, void *addr)
     return -1;
   uint32_t len = file_length(file); 
   /* Allocate mmap_file */
-  mmap_f = malloc(sizeof(struct mmap_file));
+  mmap_f = kmem_cache_alloc(&mmap_cache);
   if (mmap_f == NULL)
     return -1;
   /* Set the mapid */
@@ -448,7 +454,7 @@ mmap (int fd, void *addr)
       
       /* For virtual memory */
       /* Allocate vm_entry */
-      vm_e = malloc(sizeof(struct vm_entry));
+      vm_e = alloc_vme();
       if (vm_e == NULL) 
         return -1;
 
@@ -502,7 +508,7 @@ munmap (int mapping)
       list_remove(e);
       e = a;
       /* Free the mmap_file */
-      free(mmap_f);
+      kmem_cache_free(&mmap_cache, mmap_f);
       if(mapping == EXIT_PROCESS)
         continue;
       else break;
@@ -15,6 +15,10 @@
 #include <threads/malloc.h>       // For using memset function
 #include "threads/vaddr.h"        // For using pg_round_down function
 #include "threads/thread.h"       // For using thread & thread functions
+#include "threads/slab.h"         // For using kmem_cache
+
+/* For slab allocation */
+static struct kmem_cache vme_cache;     /* Cache of vm_entry */
 
 /* Added function */
 /* For virtual memory */
@@ -65,7 +69,28 @@ vm_destroy_func (struct hash_elem *e, void *aux)
     pagedir_clear_page(thread_current()->pagedir, vm_e->vaddr);
   }
   /* Free the vm_entry */
-  free(vm_e);
+  free_vme(vm_e);
+}
+
+/* Initialize the cache of vm_entry */
+void
+vme_cache_init (void)
+{
+  kmem_cache_init(&vme_cache, "vm_entry", sizeof(struct vm_entry), 0, NULL);
+}
+
+/* Allocate vm_entry from the cache */
+struct vm_entry *
+alloc_vme (void)
+{
+  return kmem_cache_alloc(&vme_cache);
+}
+
+/* Return vm_entry to the cache */
+void
+free_vme (struct vm_entry *vme)
+{
+  kmem_cache_free(&vme_cache, vme);
 }
 
 /* Initialize hash table */
@@ -95,12 +120,12 @@ delete_vme (struct hash *vm, struct vm_entry *vme)
   if(hash_delete(vm, &vme->elem) != NULL)
   {
     /* Free the memory of vm_entry */
-    free(vme);
+    free_vme(vme);
     return true;
   }
   else 
   {
-    free(vme);
+    free_vme(vme);
     return false;
   }
 }
@@ -57,6 +57,9 @@ struct page
 
 /* Added function */
 /* For virtual memory */
+void vme_cache_init (void);
+struct vm_entry *alloc_vme (void);
+void free_vme (struct vm_entry *vme);
 void vm_init (struct hash *vm);
 bool insert_vme (struct hash *vm, struct vm_entry *vme);
 bool delete_vme (struct hash *vm, struct vm_entry *vme);
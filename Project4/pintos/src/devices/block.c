@@ -3,8 +3,44 @@
 #include <string.h>
 #include <stdio.h>
 #include "devices/ide.h"
+#include "devices/timer.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
 
+/* Number of buckets in an I/O histogram.  Bucket I counts
+   samples in the range [2**I, 2**(I+1)), except that bucket 0
+   also counts samples of 0. */
+#define HIST_BUCKETS 40
+
+/* A histogram of latencies, in CPU cycles, or distances, in
+   sectors. */
+struct histogram
+  {
+    unsigned long long cnt[HIST_BUCKETS];  /* Samples per bucket. */
+    unsigned long long total;              /* Sum of all samples. */
+    unsigned long long max;                /* Largest sample. */
+  };
+
+/* I/O statistics for a block device. */
+struct block_stats
+  {
+    /* Queue depth, counting the arriving request. */
+    int in_flight;                      /* Requests in progress now. */
+    int max_depth;                      /* Largest depth seen. */
+    unsigned long long depth_sum;       /* Sum of depth at arrival. */
+
+    /* Access pattern. */
+    block_sector_t next_sector;         /* Sector after the last request. */
+    unsigned long long seq_cnt;         /* Requests for next_sector. */
+    unsigned long long rand_cnt;        /* All other requests. */
+    struct histogram distance;          /* Sectors from next_sector. */
+
+    /* Timing, in CPU cycles. */
+    struct histogram latency;           /* Measured by block layer. */
+    struct histogram wait;              /* Reported by driver. */
+    struct histogram service;           /* Reported by driver. */
+  };
+
 /* A block device. */
 struct block
   {
@@ -19,6 +55,7 @@ struct block
 
     unsigned long long read_cnt;        /* Number of sectors read. */
     unsigned long long write_cnt;       /* Number of sectors written. */
+    struct block_stats stats;           /* I/O statistics. */
   };
 
 /* List of all block devices. */
@@ -28,6 +65,11 @@ static struct list all_blocks = LIST_INITIALIZER (all_blocks);
 static struct block *block_by_role[BLOCK_ROLE_CNT];
 
 static struct block *list_elem_to_block (struct list_elem *);
+static uint64_t io_begin (struct block *, block_sector_t);
+static void io_end (struct block *, uint64_t start);
+static void histogram_add (struct histogram *, uint64_t);
+static void print_block_stats (struct block *);
+static void print_histogram (const char *name, const struct histogram *);
 
 /* Returns a human-readable name for the given block device
    TYPE. */
@@ -120,8 +162,12 @@ check_sector (struct block *block, block_sector_t sector)
 void
 block_read (struct block *block, block_sector_t sector, void *buffer)
 {
+  uint64_t start;
+
   check_sector (block, sector);
+  start = io_begin (block, sector);
   block->ops->read (block->aux, sector, buffer);
+  io_end (block, start);
   block->read_cnt++;
 }
 
@@ -133,9 +179,13 @@ block_read (struct block *block, block_sector_t sector, void *buffer)
 void
 block_write (struct block *block, block_sector_t sector, const void *buffer)
 {
+  uint64_t start;
+
   check_sector (block, sector);
   ASSERT (block->type != BLOCK_FOREIGN);
+  start = io_begin (block, sector);
   block->ops->write (block->aux, sector, buffer);
+  io_end (block, start);
   block->write_cnt++;
 }
 
@@ -160,10 +210,15 @@ block_type (struct block *block)
   return block->type;
 }
 
-/* Prints statistics for each block device used for a Pintos role. */
+/* Prints statistics for each block device used for a Pintos
+   role, followed by the I/O statistics of every block device
+   that has seen any requests.  Role devices are usually
+   partitions, so the driver-level wait and service times show
+   up under the disk that holds them. */
 void
 block_print_stats (void)
 {
+  struct list_elem *e;
   int i;
 
   for (i = 0; i < BLOCK_ROLE_CNT; i++)
@@ -176,6 +231,24 @@ block_print_stats (void)
                   block->read_cnt, block->write_cnt);
         }
     }
+
+  for (e = list_begin (&all_blocks); e != list_end (&all_blocks);
+       e = list_next (e))
+    print_block_stats (list_entry (e, struct block, list_elem));
+}
+
+/* Records that a driver spent WAIT cycles waiting for access to
+   the hardware behind BLOCK and then SERVICE cycles carrying out
+   a single request.  Drivers that cannot tell these apart need
+   not call this function: the block layer always measures the
+   total latency of each request on its own. */
+void
+block_account_io (struct block *block, uint64_t wait, uint64_t service)
+{
+  enum intr_level old_level = intr_disable ();
+  histogram_add (&block->stats.wait, wait);
+  histogram_add (&block->stats.service, service);
+  intr_set_level (old_level);
 }
 
 /* Registers a new block device with the given NAME.  If
@@ -200,6 +273,7 @@ block_register (const char *name, enum block_type type,
   block->aux = aux;
   block->read_cnt = 0;
   block->write_cnt = 0;
+  memset (&block->stats, 0, sizeof block->stats);
 
   printf ("%s: %'"PRDSNu" sectors (", block->name, block->size);
   print_human_readable_size ((uint64_t) block->size * BLOCK_SECTOR_SIZE);
@@ -221,3 +295,101 @@ list_elem_to_block (struct list_elem *list_elem)
           : NULL);
 }
 
+
+/* Updates BLOCK's queue depth and access pattern statistics for
+   a request for SECTOR that is about to be passed to the driver.
+   Returns the request's start time, to be passed to io_end(). */
+static uint64_t
+io_begin (struct block *block, block_sector_t sector)
+{
+  struct block_stats *stats = &block->stats;
+  enum intr_level old_level = intr_disable ();
+
+  stats->in_flight++;
+  stats->depth_sum += stats->in_flight;
+  if (stats->in_flight > stats->max_depth)
+    stats->max_depth = stats->in_flight;
+
+  if (sector == stats->next_sector)
+    stats->seq_cnt++;
+  else
+    stats->rand_cnt++;
+  histogram_add (&stats->distance,
+                 (sector > stats->next_sector
+                  ? sector - stats->next_sector
+                  : stats->next_sector - sector));
+  stats->next_sector = sector + 1;
+
+  intr_set_level (old_level);
+  return timer_cycles ();
+}
+
+/* Records the completion of a request on BLOCK that io_begin()
+   said started at START. */
+static void
+io_end (struct block *block, uint64_t start)
+{
+  uint64_t latency = timer_cycles () - start;
+  enum intr_level old_level = intr_disable ();
+
+  block->stats.in_flight--;
+  histogram_add (&block->stats.latency, latency);
+
+  intr_set_level (old_level);
+}
+
+/* Adds VALUE to histogram H. */
+static void
+histogram_add (struct histogram *h, uint64_t value)
+{
+  int bucket = 0;
+
+  while (bucket < HIST_BUCKETS - 1 && (value >> (bucket + 1)) != 0)
+    bucket++;
+  h->cnt[bucket]++;
+  h->total += value;
+  if (value > h->max)
+    h->max = value;
+}
+
+/* Prints the I/O statistics for BLOCK, if it has seen any
+   requests. */
+static void
+print_block_stats (struct block *block)
+{
+  const struct block_stats *stats = &block->stats;
+  unsigned long long requests = stats->seq_cnt + stats->rand_cnt;
+
+  if (requests == 0)
+    return;
+
+  printf ("%s: %llu requests, queue depth avg %llu max %d, "
+          "%llu sequential, %llu random\n",
+          block->name, requests, stats->depth_sum / requests,
+          stats->max_depth, stats->seq_cnt, stats->rand_cnt);
+  print_histogram ("seek distance (sectors)", &stats->distance);
+  print_histogram ("latency (cycles)", &stats->latency);
+  print_histogram ("driver wait (cycles)", &stats->wait);
+  print_histogram ("driver service (cycles)", &stats->service);
+}
+
+/* Prints histogram H, labeled NAME, omitting empty buckets.
+   Prints nothing if H is empty. */
+static void
+print_histogram (const char *name, const struct histogram *h)
+{
+  unsigned long long samples = 0;
+  int i;
+
+  for (i = 0; i < HIST_BUCKETS; i++)
+    samples += h->cnt[i];
+  if (samples == 0)
+    return;
+
+  printf ("  %s: avg %llu, max %llu\n   ",
+          name, h->total / samples, h->max);
+  for (i = 0; i < HIST_BUCKETS; i++)
+    if (h->cnt[i] != 0)
+      printf (" 2^%d:%llu", i, h->cnt[i]);
+  printf ("\n");
+}
@@ -70,5 +70,6 @@ struct block_operations
 struct block *block_register (const char *name, enum block_type,
                               const char *extra_info, block_sector_t size,
                               const struct block_operations *, void *aux);
+void block_account_io (struct block *, uint64_t wait, uint64_t service);
 
 #endif /* devices/block.h */
@@ -9,6 +9,7 @@
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -57,6 +58,11 @@ struct ata_disk
     struct channel *channel;    /* Channel that disk is attached to. */
     int dev_no;                 /* Device 0 or 1 for master or slave. */
     bool is_ata;                /* Is device an ATA disk? */
+    struct block *block;        /* Block device, once registered. */
+
+    /* Identity, read by identify_ata_device(). */
+    block_sector_t capacity;    /* Size in sectors. */
+    char info[128];             /* Model and serial number. */
   };
 
 /* An ATA channel (aka controller).
@@ -71,6 +77,7 @@ struct channel
     bool expecting_interrupt;   /* True if an interrupt is expected, false if
                                    any interrupt would be spurious. */
     struct semaphore completion_wait;   /* Up'd by interrupt handler. */
+    struct semaphore registered;        /* Up'd once disks registered. */
 
     struct ata_disk devices[2];     /* The devices on this channel. */
   };
@@ -81,10 +88,14 @@ static struct channel channels[CHANNEL_CNT];
 
 static struct block_operations ide_operations;
 
+static thread_func probe_channel;
 static void reset_channel (struct channel *);
 static bool check_device_type (struct ata_disk *);
 static void identify_ata_device (struct ata_disk *);
+static void register_ata_device (struct ata_disk *);
 
+static void account_io (struct ata_disk *, uint64_t start,
+                        uint64_t acquired);
 static void select_sector (struct ata_disk *, block_sector_t);
 static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
@@ -123,9 +134,10 @@ ide_init (void)
         default:
           NOT_REACHED ();
         }
-      lock_init (&c->lock);
+      lock_init_named (&c->lock, c->name);
       c->expecting_interrupt = false;
       sema_init (&c->completion_wait, 0);
+      sema_init (&c->registered, 0);
  
       /* Initialize devices. */
       for (dev_no = 0; dev_no < 2; dev_no++)
@@ -136,24 +148,69 @@ ide_init (void)
           d->channel = c;
           d->dev_no = dev_no;
           d->is_ata = false;
+          d->block = NULL;
         }
 
       /* Register interrupt handler. */
       intr_register_ext (c->irq, interrupt_handler, c->name);
 
-      /* Reset hardware. */
-      reset_channel (c);
+      /* Probe the channel in the background. */
+      if (thread_create (c->name, PRI_DEFAULT, probe_channel, c)
+          == TID_ERROR)
+        PANIC ("%s: could not start probe thread", c->name);
+    }
+}
 
-      /* Distinguish ATA hard disks from other devices. */
-      if (check_device_type (&c->devices[0]))
-        check_device_type (&c->devices[1]);
+/* Waits until every channel has been probed and all the disks
+   and partitions on it have been registered with the block
+   layer. */
+void
+ide_wait (void) 
+{
+  static bool done;
 
-      /* Read hard disk identity information. */
-      for (dev_no = 0; dev_no < 2; dev_no++)
-        if (c->devices[dev_no].is_ata)
-          identify_ata_device (&c->devices[dev_no]);
+  if (!done) 
+    {
+      sema_down (&channels[CHANNEL_CNT - 1].registered);
+      done = true;
     }
 }
+
+/* Probes channel C_, in a thread of its own.
+
+   Resetting a channel takes at least 150 ms, most of it spent
+   sleeping, so probing the channels one after another would
+   leave the CPU idle for much of the boot.  Instead, all the
+   channels are reset and identified at once.  Only registration
+   with the block layer, including the partition scan, is done
+   in channel order, so that devices are still numbered and
+   listed in the same order as before. */
+static void
+probe_channel (void *c_) 
+{
+  struct channel *c = c_;
+  int dev_no;
+
+  /* Reset hardware. */
+  reset_channel (c);
+
+  /* Distinguish ATA hard disks from other devices. */
+  if (check_device_type (&c->devices[0]))
+    check_device_type (&c->devices[1]);
+
+  /* Read hard disk identity information. */
+  for (dev_no = 0; dev_no < 2; dev_no++)
+    if (c->devices[dev_no].is_ata)
+      identify_ata_device (&c->devices[dev_no]);
+
+  /* Register disks after the previous channel's. */
+  if (c != &channels[0])
+    sema_down (&c[-1].registered);
+  for (dev_no = 0; dev_no < 2; dev_no++)
+    if (c->devices[dev_no].is_ata)
+      register_ata_device (&c->devices[dev_no]);
+  sema_up (&c->registered);
+}
 
 /* Disk detection and identification. */
 
@@ -254,8 +311,7 @@ check_device_type (struct ata_disk *d)
 }
 
 /* Sends an IDENTIFY DEVICE command to disk D and reads the
-   response.  Registers the disk with the block device
-   layer. */
+   response into D. */
 static void
 identify_ata_device (struct ata_disk *d) 
 {
@@ -263,8 +319,6 @@ identify_ata_device (struct ata_disk *d)
   char id[BLOCK_SECTOR_SIZE];
   block_sector_t capacity;
   char *model, *serial;
-  char extra_info[128];
-  struct block *block;
 
   ASSERT (d->is_ata);
 
@@ -286,7 +340,7 @@ identify_ata_device (struct ata_disk *d)
   capacity = *(uint32_t *) &id[60 * 2];
   model = descramble_ata_string (&id[10 * 2], 20);
   serial = descramble_ata_string (&id[27 * 2], 40);
-  snprintf (extra_info, sizeof extra_info,
+  snprintf (d->info, sizeof d->info,
             "model \"%s\", serial \"%s\"", model, serial);
 
   /* Disable access to IDE disks over 1 GB, which are likely
@@ -303,10 +357,17 @@ identify_ata_device (struct ata_disk *d)
       return;
     }
 
-  /* Register. */
-  block = block_register (d->name, BLOCK_RAW, extra_info, capacity,
-                          &ide_operations, d);
-  partition_scan (block);
+  d->capacity = capacity;
+}
+
+/* Registers disk D, already identified, with the block device
+   layer and scans it for partitions. */
+static void
+register_ata_device (struct ata_disk *d) 
+{
+  d->block = block_register (d->name, BLOCK_RAW, d->info, d->capacity,
+                             &ide_operations, d);
+  partition_scan (d->block);
 }
 
 /* Translates STRING, which consists of SIZE bytes in a funky
@@ -346,13 +407,17 @@ ide_read (void *d_, block_sector_t sec_no, void *buffer)
 {
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
+  uint64_t start = timer_cycles ();
+  uint64_t acquired;
   lock_acquire (&c->lock);
+  acquired = timer_cycles ();
   select_sector (d, sec_no);
   issue_pio_command (c, CMD_READ_SECTOR_RETRY);
   sema_down (&c->completion_wait);
   if (!wait_while_busy (d))
     PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
   input_sector (c, buffer);
+  account_io (d, start, acquired);
   lock_release (&c->lock);
 }
 
@@ -366,16 +431,32 @@ ide_write (void *d_, block_sector_t sec_no, const void *buffer)
 {
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
+  uint64_t start = timer_cycles ();
+  uint64_t acquired;
   lock_acquire (&c->lock);
+  acquired = timer_cycles ();
   select_sector (d, sec_no);
   issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
   if (!wait_while_busy (d))
     PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
   output_sector (c, buffer);
   sema_down (&c->completion_wait);
+  account_io (d, start, acquired);
   lock_release (&c->lock);
 }
 
+/* Reports a request on disk D to the block layer.  The request
+   arrived at START and obtained D's channel at ACQUIRED, so
+   everything before ACQUIRED was spent waiting behind requests
+   for other disks (or the other device) on the same channel. */
+static void
+account_io (struct ata_disk *d, uint64_t start, uint64_t acquired)
+{
+  if (d->block != NULL)
+    block_account_io (d->block, acquired - start,
+                      timer_cycles () - acquired);
+}
+
 static struct block_operations ide_operations =
   {
     ide_read,
@@ -2,5 +2,6 @@
 #define DEVICES_IDE_H
 
 void ide_init (void);
+void ide_wait (void);
 
 #endif /* devices/ide.h */
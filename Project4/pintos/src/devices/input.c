@@ -3,14 +3,18 @@
 #include "devices/intq.h"
 #include "devices/serial.h"
 
+/* Input buffer size, in bytes.  Must be a power of 2. */
+#define INPUT_BUFSIZE 256
+
 /* Stores keys from the keyboard and serial port. */
 static struct intq buffer;
+static uint8_t buffer_bytes[INPUT_BUFSIZE];
 
 /* Initializes the input buffer. */
 void
 input_init (void) 
 {
-  intq_init (&buffer);
+  intq_init (&buffer, buffer_bytes, INPUT_BUFSIZE);
 }
 
 /* Adds a key to the input buffer.
@@ -33,8 +37,8 @@ input_getc (void)
   enum intr_level old_level;
   uint8_t key;
 
-  old_level = intr_disable ();
   key = intq_getc (&buffer);
+  old_level = intr_disable ();
   serial_notify ();
   intr_set_level (old_level);
   
@@ -2,33 +2,120 @@
 #include <debug.h>
 #include "threads/thread.h"
 
-static int next (int pos);
-static void wait (struct intq *q, struct thread **waiter);
-static void signal (struct intq *q, struct thread **waiter);
+static void wait (struct intq *q, struct thread *volatile *waiter);
+static void signal (struct intq *q, struct thread *volatile *waiter);
 
-/* Initializes interrupt queue Q. */
+/* Initializes interrupt queue Q to hold up to SIZE bytes in BUF,
+   which must stay valid for Q's lifetime.  SIZE must be a power
+   of 2. */
 void
-intq_init (struct intq *q) 
+intq_init (struct intq *q, void *buf, size_t size) 
 {
-  lock_init (&q->lock);
+  lock_init_named (&q->get_lock, "intq_get");
+  lock_init_named (&q->put_lock, "intq_put");
   q->not_full = q->not_empty = NULL;
-  q->head = q->tail = 0;
+  ringbuf_init (&q->ring, buf, 1, size);
 }
 
-/* Returns true if Q is empty, false otherwise. */
+/* Initializes interrupt queue Q to hold at least SIZE bytes, in
+   memory obtained from malloc().  Returns true if successful,
+   false if memory allocation failed. */
+bool
+intq_create (struct intq *q, size_t size) 
+{
+  if (!ringbuf_create (&q->ring, 1, size))
+    return false;
+  lock_init_named (&q->get_lock, "intq_get");
+  lock_init_named (&q->put_lock, "intq_put");
+  q->not_full = q->not_empty = NULL;
+  return true;
+}
+
+/* Destroys Q, which must have been initialized with
+   intq_create() and must have no waiting threads.  Any bytes
+   still in Q are lost. */
+void
+intq_destroy (struct intq *q) 
+{
+  ASSERT (q->not_full == NULL && q->not_empty == NULL);
+  ringbuf_destroy (&q->ring);
+}
+
+/* Returns true if Q is empty, false otherwise.  The answer may
+   be out of date by the time it is returned unless the caller is
+   Q's consumer. */
 bool
 intq_empty (const struct intq *q) 
 {
-  ASSERT (intr_get_level () == INTR_OFF);
-  return q->head == q->tail;
+  return ringbuf_empty (&q->ring);
 }
 
-/* Returns true if Q is full, false otherwise. */
+/* Returns true if Q is full, false otherwise.  The answer may
+   be out of date by the time it is returned unless the caller is
+   Q's producer. */
 bool
 intq_full (const struct intq *q) 
 {
-  ASSERT (intr_get_level () == INTR_OFF);
-  return next (q->head) == q->tail;
+  return ringbuf_full (&q->ring);
+}
+
+/* Removes up to CNT bytes from Q and stores them in BUF, and
+   returns the number removed.
+   When called from a kernel thread, sleeps while Q is empty, so
+   at least one byte is removed unless CNT is 0.  When called
+   from an interrupt handler, removes only the bytes already in
+   Q, which may be none. */
+size_t
+intq_get (struct intq *q, void *buf, size_t cnt) 
+{
+  size_t got;
+
+  if (intr_context ())
+    got = ringbuf_get (&q->ring, buf, cnt);
+  else
+    {
+      lock_acquire (&q->get_lock);
+      while ((got = ringbuf_get (&q->ring, buf, cnt)) == 0 && cnt > 0)
+        wait (q, &q->not_empty);
+      lock_release (&q->get_lock);
+    }
+
+  if (got > 0)
+    signal (q, &q->not_full);
+  return got;
+}
+
+/* Adds the CNT bytes in BUF to the end of Q and returns the
+   number added.
+   When called from a kernel thread, sleeps whenever Q is full,
+   so all CNT bytes are added.  When called from an interrupt
+   handler, adds only as many bytes as fit. */
+size_t
+intq_put (struct intq *q, const void *buf_, size_t cnt) 
+{
+  const uint8_t *buf = buf_;
+  size_t done;
+
+  if (intr_context ())
+    done = ringbuf_put (&q->ring, buf, cnt);
+  else
+    {
+      lock_acquire (&q->put_lock);
+      done = ringbuf_put (&q->ring, buf, cnt);
+      while (done < cnt)
+        {
+          /* Let the consumer at what is already queued, then
+             wait for it to make room. */
+          signal (q, &q->not_empty);
+          wait (q, &q->not_full);
+          done += ringbuf_put (&q->ring, buf + done, cnt - done);
+        }
+      lock_release (&q->put_lock);
+    }
+
+  if (done > 0)
+    signal (q, &q->not_empty);
+  return done;
 }
 
 /* Removes a byte from Q and returns it.
@@ -38,19 +125,10 @@ uint8_t
 intq_getc (struct intq *q) 
 {
   uint8_t byte;
-  
-  ASSERT (intr_get_level () == INTR_OFF);
-  while (intq_empty (q)) 
-    {
-      ASSERT (!intr_context ());
-      lock_acquire (&q->lock);
-      wait (q, &q->not_empty);
-      lock_release (&q->lock);
-    }
-  
-  byte = q->buf[q->tail];
-  q->tail = next (q->tail);
-  signal (q, &q->not_full);
+  size_t cnt UNUSED;
+
+  cnt = intq_get (q, &byte, 1);
+  ASSERT (cnt == 1);
   return byte;
 }
 
@@ -60,39 +138,34 @@ intq_getc (struct intq *q)
 void
 intq_putc (struct intq *q, uint8_t byte) 
 {
-  ASSERT (intr_get_level () == INTR_OFF);
-  while (intq_full (q))
-    {
-      ASSERT (!intr_context ());
-      lock_acquire (&q->lock);
-      wait (q, &q->not_full);
-      lock_release (&q->lock);
-    }
+  size_t cnt UNUSED;
 
-  q->buf[q->head] = byte;
-  q->head = next (q->head);
-  signal (q, &q->not_empty);
-}
-
-/* Returns the position after POS within an intq. */
-static int
-next (int pos) 
-{
-  return (pos + 1) % INTQ_BUFSIZE;
+  cnt = intq_put (q, &byte, 1);
+  ASSERT (cnt == 1);
 }
 
 /* WAITER must be the address of Q's not_empty or not_full
-   member.  Waits until the given condition is true. */
+   member.  Waits until the given condition is true.
+
+   Setting *WAITER and checking the condition are done with
+   interrupts off, and the other side publishes its progress in
+   the ring before looking at *WAITER, so the other side either
+   sees this thread in *WAITER or has already made the condition
+   true. */
 static void
-wait (struct intq *q UNUSED, struct thread **waiter) 
+wait (struct intq *q, struct thread *volatile *waiter) 
 {
+  enum intr_level old_level;
+
   ASSERT (!intr_context ());
-  ASSERT (intr_get_level () == INTR_OFF);
-  ASSERT ((waiter == &q->not_empty && intq_empty (q))
-          || (waiter == &q->not_full && intq_full (q)));
+  ASSERT (waiter == &q->not_empty || waiter == &q->not_full);
 
+  old_level = intr_disable ();
   *waiter = thread_current ();
-  thread_block ();
+  if (waiter == &q->not_empty ? intq_empty (q) : intq_full (q))
+    thread_block ();
+  *waiter = NULL;
+  intr_set_level (old_level);
 }
 
 /* WAITER must be the address of Q's not_empty or not_full
@@ -100,15 +173,20 @@ wait (struct intq *q UNUSED, struct thread **waiter)
    thread is waiting for the condition, wakes it up and resets
    the waiting thread. */
 static void
-signal (struct intq *q UNUSED, struct thread **waiter) 
+signal (struct intq *q UNUSED, struct thread *volatile *waiter) 
 {
-  ASSERT (intr_get_level () == INTR_OFF);
-  ASSERT ((waiter == &q->not_empty && !intq_empty (q))
-          || (waiter == &q->not_full && !intq_full (q)));
+  enum intr_level old_level;
+
+  ASSERT (waiter == &q->not_empty || waiter == &q->not_full);
+
+  if (*waiter == NULL)
+    return;
 
+  old_level = intr_disable ();
   if (*waiter != NULL) 
     {
       thread_unblock (*waiter);
       *waiter = NULL;
     }
+  intr_set_level (old_level);
 }
@@ -1,42 +1,50 @@
 #ifndef DEVICES_INTQ_H
 #define DEVICES_INTQ_H
 
+#include <ringbuf.h>
+#include <stddef.h>
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 
 /* An "interrupt queue", a circular buffer shared between
    kernel threads and external interrupt handlers.
 
-   Interrupt queue functions can be called from kernel threads or
-   from external interrupt handlers.  Except for intq_init(),
-   interrupts must be off in either case.
+   The bytes are kept in a ring buffer (see lib/kernel/ringbuf.h)
+   with one producer and one consumer, so moving bytes in or out
+   does not require turning interrupts off.  Each side of the
+   queue, producer or consumer, must be either external interrupt
+   handlers only, which cannot interrupt each other, or kernel
+   threads only, which take turns on that side's lock.  Interrupts
+   are turned off only for a moment, when a thread must sleep
+   until the other side makes progress.
 
-   The interrupt queue has the structure of a "monitor".  Locks
-   and condition variables from threads/synch.h cannot be used in
-   this case, as they normally would, because they can only
-   protect kernel threads from one another, not from interrupt
-   handlers. */
-
-/* Queue buffer size, in bytes. */
-#define INTQ_BUFSIZE 64
+   Locks and condition variables from threads/synch.h cannot be
+   used to wait here, as they normally would, because an
+   interrupt handler can neither acquire a lock nor wait on a
+   condition. */
 
 /* A circular queue of bytes. */
 struct intq
   {
-    /* Waiting threads. */
-    struct lock lock;           /* Only one thread may wait at once. */
-    struct thread *not_full;    /* Thread waiting for not-full condition. */
-    struct thread *not_empty;   /* Thread waiting for not-empty condition. */
+    /* Threads on each side. */
+    struct lock get_lock;       /* Held by the consuming thread. */
+    struct lock put_lock;       /* Held by the producing thread. */
+    struct thread *volatile not_full;   /* Producer waiting for room. */
+    struct thread *volatile not_empty;  /* Consumer waiting for bytes. */
 
     /* Queue. */
-    uint8_t buf[INTQ_BUFSIZE];  /* Buffer. */
-    int head;                   /* New data is written here. */
-    int tail;                   /* Old data is read here. */
+    struct ringbuf ring;        /* Queued bytes. */
   };
 
-void intq_init (struct intq *);
+void intq_init (struct intq *, void *buf, size_t size);
+bool intq_create (struct intq *, size_t size);
+void intq_destroy (struct intq *);
+
 bool intq_empty (const struct intq *);
 bool intq_full (const struct intq *);
+
+size_t intq_get (struct intq *, void *, size_t cnt);
+size_t intq_put (struct intq *, const void *, size_t cnt);
 uint8_t intq_getc (struct intq *);
 void intq_putc (struct intq *, uint8_t);
 
@@ -1,7 +1,7 @@
 #include "devices/serial.h"
 #include <debug.h>
+#include <ringbuf.h>
 #include "devices/input.h"
-#include "devices/intq.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
@@ -33,6 +33,16 @@
 #define MCR_REG (IO_BASE + 4)   /* MODEM Control Register. */
 #define LSR_REG (IO_BASE + 5)   /* Line Status Register (read-only). */
 
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /* Enable transmit and receive FIFOs. */
+#define FCR_CLEAR_RECV 0x02     /* Clear receive FIFO. */
+#define FCR_CLEAR_XMIT 0x04     /* Clear transmit FIFO. */
+
+/* Number of bytes that the 16550A's transmit FIFO holds.  When
+   the THR Empty bit is set, this many bytes may be written to
+   THR_REG without waiting. */
+#define XMIT_FIFO_SIZE 16
+
 /* Interrupt Enable Register bits. */
 #define IER_RECV 0x01           /* Interrupt when data received. */
 #define IER_XMIT 0x02           /* Interrupt when transmit finishes. */
@@ -51,11 +61,27 @@
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
 
-/* Data to be transmitted. */
-static struct intq txq;
+/* Transmit ring buffer size, in bytes.  Must be a power of 2. */
+#define TXQ_SIZE 8192
+
+/* Data to be transmitted.  The producer is serial_putc() and
+   the consumer is whoever loads the transmit FIFO, usually the
+   interrupt handler. */
+static struct ringbuf txq;
+static uint8_t txq_buf[TXQ_SIZE];
+
+/* A thread waiting for room in txq.  Only one thread may wait at
+   once, so waiters queue up on txq_lock first. */
+static struct lock txq_lock;
+static struct thread *txq_waiter;
+
+/* Current value of the Interrupt Enable Register. */
+static uint8_t ier;
 
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
+static void load_xmit_fifo (void);
+static void fill_xmit_fifo (void);
 static void write_ier (void);
 static intr_handler_func serial_interrupt;
 
@@ -68,10 +94,10 @@ init_poll (void)
 {
   ASSERT (mode == UNINIT);
   outb (IER_REG, 0);                    /* Turn off all interrupts. */
-  outb (FCR_REG, 0);                    /* Disable FIFO. */
+  outb (FCR_REG, FCR_ENABLE | FCR_CLEAR_RECV | FCR_CLEAR_XMIT);
   set_serial (9600);                    /* 9.6 kbps, N-8-1. */
   outb (MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
-  intq_init (&txq);
+  ringbuf_init (&txq, txq_buf, 1, TXQ_SIZE);
   mode = POLL;
 } 
 
@@ -87,6 +113,7 @@ serial_init_queue (void)
     init_poll ();
   ASSERT (mode == POLL);
 
+  lock_init (&txq_lock);
   intr_register_ext (0x20 + 4, serial_interrupt, "serial");
   mode = QUEUE;
   old_level = intr_disable ();
@@ -110,20 +137,36 @@ serial_putc (uint8_t byte)
     }
   else 
     {
-      /* Otherwise, queue a byte and update the interrupt enable
-         register. */
-      if (old_level == INTR_OFF && intq_full (&txq)) 
+      /* Otherwise, queue a byte and make sure the transmit
+         interrupt is enabled.  The interrupt handler refills the
+         FIFO a whole load at a time, so when the transmitter is
+         already busy there is no need to touch the hardware. */
+      while (ringbuf_full (&txq)) 
         {
-          /* Interrupts are off and the transmit queue is full.
-             If we wanted to wait for the queue to empty,
-             we'd have to reenable interrupts.
-             That's impolite, so we'll send a character via
-             polling instead. */
-          putc_poll (intq_getc (&txq)); 
+          if (old_level == INTR_OFF || intr_context ()) 
+            {
+              /* Interrupts are off and the transmit queue is
+                 full.  If we wanted to wait for the queue to
+                 empty, we'd have to reenable interrupts.  That's
+                 impolite, so we'll send a FIFO load via polling
+                 instead. */
+              load_xmit_fifo ();
+            }
+          else
+            {
+              lock_acquire (&txq_lock);
+              if (ringbuf_full (&txq)) 
+                {
+                  txq_waiter = thread_current ();
+                  thread_block ();
+                }
+              lock_release (&txq_lock);
+            }
         }
 
-      intq_putc (&txq, byte); 
-      write_ier ();
+      ringbuf_put (&txq, &byte, 1);
+      if ((ier & IER_XMIT) == 0)
+        write_ier ();
     }
   
   intr_set_level (old_level);
@@ -135,8 +178,8 @@ void
 serial_flush (void) 
 {
   enum intr_level old_level = intr_disable ();
-  while (!intq_empty (&txq))
-    putc_poll (intq_getc (&txq));
+  while (!ringbuf_empty (&txq))
+    load_xmit_fifo ();
   intr_set_level (old_level);
 }
 
@@ -172,17 +215,52 @@ set_serial (int bps)
   outb (LCR_REG, LCR_N81);
 }
 
+/* Polls the serial port until its transmit FIFO is empty, and
+   then refills it from the transmit queue. */
+static void
+load_xmit_fifo (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while ((inb (LSR_REG) & LSR_THRE) == 0)
+    continue;
+  fill_xmit_fifo ();
+}
+
+/* Moves as many bytes from the transmit queue into the empty
+   transmit FIFO as it will hold, and wakes up a thread waiting
+   for room in the queue, if any.  This is txq's consumer, so
+   interrupts must be off. */
+static void
+fill_xmit_fifo (void) 
+{
+  uint8_t load[XMIT_FIFO_SIZE];
+  size_t cnt, i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  cnt = ringbuf_get (&txq, load, XMIT_FIFO_SIZE);
+  for (i = 0; i < cnt; i++)
+    outb (THR_REG, load[i]);
+
+  if (txq_waiter != NULL && !ringbuf_full (&txq)) 
+    {
+      thread_unblock (txq_waiter);
+      txq_waiter = NULL;
+    }
+}
+
 /* Update interrupt enable register. */
 static void
 write_ier (void) 
 {
-  uint8_t ier = 0;
-
   ASSERT (intr_get_level () == INTR_OFF);
 
+  ier = 0;
+
   /* Enable transmit interrupt if we have any characters to
      transmit. */
-  if (!intq_empty (&txq))
+  if (!ringbuf_empty (&txq))
     ier |= IER_XMIT;
 
   /* Enable receive interrupt if we have room to store any
@@ -218,10 +296,11 @@ serial_interrupt (struct intr_frame *f UNUSED)
   while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
     input_putc (inb (RBR_REG));
 
-  /* As long as we have a byte to transmit, and the hardware is
-     ready to accept a byte for transmission, transmit a byte. */
-  while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
-    outb (THR_REG, intq_getc (&txq));
+  /* If the transmit FIFO is empty, refill it with as many bytes
+     as it holds, so that we take one interrupt per FIFO load
+     instead of one per byte. */
+  if ((inb (LSR_REG) & LSR_THRE) != 0) 
+    fill_xmit_fifo ();
 
   /* Update interrupt enable register based on queue status. */
   write_ier ();
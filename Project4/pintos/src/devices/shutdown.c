@@ -5,6 +5,8 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/profile.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
@@ -20,8 +22,6 @@
 /* How to shut down when shutdown() is called. */
 static enum shutdown_type how = SHUTDOWN_NONE;
 
-static void print_stats (void);
-
 /* Shuts down the machine in the way configured by
    shutdown_configure().  If the shutdown type is SHUTDOWN_NONE
    (which is the default), returns without doing anything. */
@@ -94,7 +94,8 @@ shutdown_power_off (void)
   filesys_done ();
 #endif
 
-  print_stats ();
+  shutdown_print_stats ();
+  profile_dump ();
 
   printf ("Powering off...\n");
   serial_flush ();
@@ -114,9 +115,10 @@ shutdown_power_off (void)
   for (;;);
 }
 
-/* Print statistics about Pintos execution. */
-static void
-print_stats (void)
+/* Print statistics about Pintos execution.  Called at power
+   off, and on demand by the "stats" system call. */
+void
+shutdown_print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
@@ -124,6 +126,7 @@ print_stats (void)
   block_print_stats ();
 #endif
   console_print_stats ();
+  lock_print_stats ();
   kbd_print_stats ();
 #ifdef USERPROG
   exception_print_stats ();
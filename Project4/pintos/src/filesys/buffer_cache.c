@@ -27,7 +27,7 @@ bc_init(void)
       // Allocation buffer_cache in memory
       memset (bh, 0, sizeof(struct buffer_head));
       // Initialize buffer_head variable
-      lock_init(&bh->lock);
+      lock_init_named (&bh->lock, "buffer head");
       bh->buffer = point;
       bh++; 
       point += BLOCK_SECTOR_SIZE;
@@ -6,14 +6,21 @@
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#include "threads/synch.h"
 
 /* Partition that contains the file system. */
 struct block *fs_device;
 
+/* True if the file system is to be formatted but has not been
+   yet.  See filesys_ready(). */
+static bool format_pending;
+static struct lock format_lock;
+
 static void do_format (void);
 
 /* Initializes the file system module.
-   If FORMAT is true, reformats the file system. */
+   If FORMAT is true, reformats the file system, but not until it
+   is first used. */
 void
 filesys_init (bool format) 
 {
@@ -23,11 +30,36 @@ filesys_init (bool format)
 
   inode_init ();
   free_map_init ();
+  lock_init (&format_lock);
 
   if (format) 
-    do_format ();
+    format_pending = true;
+  else
+    free_map_open ();
+}
+
+/* Makes the file system ready for use, formatting it first if
+   that was requested and has not been done yet.  Called on every
+   path into the file system that does not go through an already
+   open file.
+
+   Formatting writes the free map and the root directory, which
+   is slow enough to matter in short runs, so it is deferred out
+   of the boot path to here. */
+void
+filesys_ready (void) 
+{
+  if (!format_pending)
+    return;
 
-  free_map_open ();
+  lock_acquire (&format_lock);
+  if (format_pending) 
+    {
+      do_format ();
+      free_map_open ();
+      format_pending = false;
+    }
+  lock_release (&format_lock);
 }
 
 /* Shuts down the file system module, writing any unwritten data
@@ -35,6 +67,7 @@ filesys_init (bool format)
 void
 filesys_done (void) 
 {
+  filesys_ready ();
   free_map_close ();
 }
 
@@ -46,11 +79,15 @@ bool
 filesys_create (const char *name, off_t initial_size) 
 {
   block_sector_t inode_sector = 0;
-  struct dir *dir = dir_open_root ();
-  bool success = (dir != NULL
-                  && free_map_allocate (1, &inode_sector)
-                  && inode_create (inode_sector, initial_size)
-                  && dir_add (dir, name, inode_sector));
+  struct dir *dir;
+  bool success;
+
+  filesys_ready ();
+  dir = dir_open_root ();
+  success = (dir != NULL
+             && free_map_allocate (1, &inode_sector)
+             && inode_create (inode_sector, initial_size)
+             && dir_add (dir, name, inode_sector));
   if (!success && inode_sector != 0) 
     free_map_release (inode_sector, 1);
   dir_close (dir);
@@ -66,9 +103,11 @@ filesys_create (const char *name, off_t initial_size)
 struct file *
 filesys_open (const char *name)
 {
-  struct dir *dir = dir_open_root ();
+  struct dir *dir;
   struct inode *inode = NULL;
 
+  filesys_ready ();
+  dir = dir_open_root ();
   if (dir != NULL)
     dir_lookup (dir, name, &inode);
   dir_close (dir);
@@ -83,8 +122,12 @@ filesys_open (const char *name)
 bool
 filesys_remove (const char *name) 
 {
-  struct dir *dir = dir_open_root ();
-  bool success = dir != NULL && dir_remove (dir, name);
+  struct dir *dir;
+  bool success;
+
+  filesys_ready ();
+  dir = dir_open_root ();
+  success = dir != NULL && dir_remove (dir, name);
   dir_close (dir); 
 
   return success;
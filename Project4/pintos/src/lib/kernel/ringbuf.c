@@ -0,0 +1,220 @@
+/* Ring buffer.
+
+   See ringbuf.h for basic information. */
+
+#include "ringbuf.h"
+#include "../debug.h"
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+static void copy_in (struct ringbuf *, size_t idx,
+                     const unsigned char *, size_t cnt);
+static void copy_out (const struct ringbuf *, size_t idx,
+                      unsigned char *, size_t cnt);
+
+/* Returns true if X is a power of 2, false otherwise. */
+static inline bool
+is_power_of_2 (size_t x)
+{
+  return x != 0 && (x & (x - 1)) == 0;
+}
+
+/* Initializes RB as an empty ring buffer of CAPACITY elements of
+   ELEM_SIZE bytes each, stored in BUF, which must be at least
+   CAPACITY * ELEM_SIZE bytes long and must stay valid for RB's
+   lifetime.  CAPACITY must be a power of 2. */
+void
+ringbuf_init (struct ringbuf *rb, void *buf,
+              size_t elem_size, size_t capacity)
+{
+  ASSERT (rb != NULL);
+  ASSERT (buf != NULL);
+  ASSERT (elem_size > 0);
+  ASSERT (is_power_of_2 (capacity));
+
+  rb->buf = buf;
+  rb->elem_size = elem_size;
+  rb->capacity = capacity;
+  rb->allocated = false;
+  rb->head = rb->tail = 0;
+}
+
+/* Initializes RB as an empty ring buffer of ELEM_SIZE-byte
+   elements, allocating storage for at least CAPACITY elements.
+   CAPACITY is rounded up to a power of 2.  Returns true if
+   successful, false if memory allocation failed. */
+bool
+ringbuf_create (struct ringbuf *rb, size_t elem_size, size_t capacity)
+{
+  size_t cap;
+  void *buf;
+
+  ASSERT (capacity > 0);
+
+  for (cap = 1; cap < capacity; cap *= 2)
+    continue;
+  buf = malloc (cap * elem_size);
+  if (buf == NULL)
+    return false;
+
+  ringbuf_init (rb, buf, elem_size, cap);
+  rb->allocated = true;
+  return true;
+}
+
+/* Destroys RB, freeing its storage if it was allocated by
+   ringbuf_create().  Any elements still in RB are lost. */
+void
+ringbuf_destroy (struct ringbuf *rb)
+{
+  ASSERT (rb != NULL);
+
+  if (rb->allocated)
+    free (rb->buf);
+  rb->buf = NULL;
+}
+
+/* Returns the number of elements that RB can hold. */
+size_t
+ringbuf_capacity (const struct ringbuf *rb)
+{
+  return rb->capacity;
+}
+
+/* Returns the number of elements in RB.  May be called by
+   either side, but the answer may already be out of date when
+   it is returned if the other side is running concurrently. */
+size_t
+ringbuf_count (const struct ringbuf *rb)
+{
+  return rb->head - rb->tail;
+}
+
+/* Returns the number of elements that could be added to RB. */
+size_t
+ringbuf_space (const struct ringbuf *rb)
+{
+  return rb->capacity - ringbuf_count (rb);
+}
+
+/* Returns true if RB holds no elements, false otherwise. */
+bool
+ringbuf_empty (const struct ringbuf *rb)
+{
+  return rb->head == rb->tail;
+}
+
+/* Returns true if RB has no room for another element, false
+   otherwise. */
+bool
+ringbuf_full (const struct ringbuf *rb)
+{
+  return ringbuf_count (rb) == rb->capacity;
+}
+
+/* Adds up to CNT elements from ELEMS to the end of RB, as many
+   as fit.  Returns the number of elements added.  Must only be
+   called by RB's producer. */
+size_t
+ringbuf_put (struct ringbuf *rb, const void *elems, size_t cnt)
+{
+  size_t head = rb->head;
+  size_t space = rb->capacity - (head - rb->tail);
+
+  if (cnt > space)
+    cnt = space;
+  if (cnt == 0)
+    return 0;
+
+  copy_in (rb, head, elems, cnt);
+
+  /* Don't let the consumer see the new elements until they have
+     been written. */
+  barrier ();
+  rb->head = head + cnt;
+  return cnt;
+}
+
+/* Removes up to CNT elements from the front of RB, as many as
+   are available, and copies them into ELEMS.  Returns the number
+   of elements removed.  Must only be called by RB's consumer. */
+size_t
+ringbuf_get (struct ringbuf *rb, void *elems, size_t cnt)
+{
+  cnt = ringbuf_peek (rb, elems, cnt);
+
+  /* Don't let the producer reuse the slots until they have been
+     read. */
+  barrier ();
+  rb->tail += cnt;
+  return cnt;
+}
+
+/* Copies up to CNT elements from the front of RB into ELEMS, as
+   many as are available, without removing them.  Returns the
+   number of elements copied.  Must only be called by RB's
+   consumer. */
+size_t
+ringbuf_peek (const struct ringbuf *rb, void *elems, size_t cnt)
+{
+  size_t tail = rb->tail;
+  size_t avail = rb->head - tail;
+
+  /* Don't read any element before reading the head index that
+     covers it. */
+  barrier ();
+  if (cnt > avail)
+    cnt = avail;
+  if (cnt > 0)
+    copy_out (rb, tail, elems, cnt);
+  return cnt;
+}
+
+/* Removes up to CNT elements from the front of RB without
+   copying them anywhere.  Returns the number of elements
+   removed.  Must only be called by RB's consumer. */
+size_t
+ringbuf_discard (struct ringbuf *rb, size_t cnt)
+{
+  size_t avail = ringbuf_count (rb);
+
+  if (cnt > avail)
+    cnt = avail;
+  rb->tail += cnt;
+  return cnt;
+}
+
+/* Copies CNT elements from SRC into RB's storage, starting at
+   free-running index IDX and wrapping around the end of the
+   storage if necessary. */
+static void
+copy_in (struct ringbuf *rb, size_t idx, const unsigned char *src,
+         size_t cnt)
+{
+  size_t ofs = idx & (rb->capacity - 1);
+  size_t first = rb->capacity - ofs;
+
+  if (first > cnt)
+    first = cnt;
+  memcpy (rb->buf + ofs * rb->elem_size, src, first * rb->elem_size);
+  memcpy (rb->buf, src + first * rb->elem_size,
+          (cnt - first) * rb->elem_size);
+}
+
+/* Copies CNT elements out of RB's storage, starting at
+   free-running index IDX and wrapping around the end of the
+   storage if necessary, into DST. */
+static void
+copy_out (const struct ringbuf *rb, size_t idx, unsigned char *dst,
+          size_t cnt)
+{
+  size_t ofs = idx & (rb->capacity - 1);
+  size_t first = rb->capacity - ofs;
+
+  if (first > cnt)
+    first = cnt;
+  memcpy (dst, rb->buf + ofs * rb->elem_size, first * rb->elem_size);
+  memcpy (dst + first * rb->elem_size, rb->buf,
+          (cnt - first) * rb->elem_size);
+}
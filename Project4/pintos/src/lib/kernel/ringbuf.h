@@ -0,0 +1,61 @@
+#ifndef __LIB_KERNEL_RINGBUF_H
+#define __LIB_KERNEL_RINGBUF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Ring buffer.
+
+   A fixed-capacity FIFO queue of equal-sized elements, for
+   passing data from exactly one producer to exactly one
+   consumer without a lock.  The producer only ever writes
+   `head' and the consumer only ever writes `tail', and each
+   side publishes its index only after it has finished with the
+   elements it covers, so the two sides may run concurrently
+   with each other, e.g. one in a kernel thread and the other in
+   an external interrupt handler.
+
+   This is not safe for more than one producer or more than one
+   consumer at a time.  If several threads may produce (or
+   consume), they must exclude each other by some other means,
+   such as a lock or by turning off interrupts.
+
+   Both indexes run freely and wrap around only through unsigned
+   overflow, so `head - tail' is always the number of elements
+   in the buffer and no slot is wasted to tell a full buffer from
+   an empty one.  For this to work the capacity must be a power
+   of 2. */
+
+/* Ring buffer. */
+struct ringbuf
+  {
+    unsigned char *buf;         /* CAPACITY * ELEM_SIZE bytes. */
+    size_t elem_size;           /* Size of each element, in bytes. */
+    size_t capacity;            /* Number of elements; a power of 2. */
+    bool allocated;             /* Was BUF obtained from malloc()? */
+    volatile size_t head;       /* Next element written here. */
+    volatile size_t tail;       /* Next element read from here. */
+  };
+
+/* Creation and destruction. */
+void ringbuf_init (struct ringbuf *, void *buf,
+                   size_t elem_size, size_t capacity);
+bool ringbuf_create (struct ringbuf *, size_t elem_size, size_t capacity);
+void ringbuf_destroy (struct ringbuf *);
+
+/* Size. */
+size_t ringbuf_capacity (const struct ringbuf *);
+size_t ringbuf_count (const struct ringbuf *);
+size_t ringbuf_space (const struct ringbuf *);
+bool ringbuf_empty (const struct ringbuf *);
+bool ringbuf_full (const struct ringbuf *);
+
+/* Producer side. */
+size_t ringbuf_put (struct ringbuf *, const void *elems, size_t cnt);
+
+/* Consumer side. */
+size_t ringbuf_get (struct ringbuf *, void *elems, size_t cnt);
+size_t ringbuf_peek (const struct ringbuf *, void *elems, size_t cnt);
+size_t ringbuf_discard (struct ringbuf *, size_t cnt);
+
+#endif /* lib/kernel/ringbuf.h */
@@ -182,3 +182,9 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+void
+stats (void)
+{
+  syscall0 (SYS_STATS);
+}
@@ -0,0 +1,88 @@
+/* Moves a long stream of bytes from a producer thread to the
+   main thread through a small interrupt queue, in bulk puts and
+   gets of assorted sizes, so that both sides must repeatedly
+   sleep until the other makes progress.  Checks that every byte
+   arrives once and in order. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "devices/intq.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Total bytes to move. */
+#define STREAM_SIZE 20000
+
+/* Queue size, much smaller than most puts and gets. */
+#define QUEUE_SIZE 16
+
+/* Largest single put or get. */
+#define CHUNK_MAX 37
+
+static struct intq q;
+static struct semaphore done;
+
+static thread_func producer;
+
+/* Returns the byte at position I in the stream. */
+static uint8_t
+stream_byte (size_t i) 
+{
+  return i * 7 + (i >> 8);
+}
+
+void
+test_intq_bulk (void) 
+{
+  uint8_t buf[CHUNK_MAX];
+  size_t pos = 0, gets = 0;
+
+  if (!intq_create (&q, QUEUE_SIZE))
+    fail ("intq_create failed");
+  sema_init (&done, 0);
+  thread_create ("producer", PRI_DEFAULT, producer, NULL);
+
+  while (pos < STREAM_SIZE) 
+    {
+      size_t want = 1 + gets++ * 5 % CHUNK_MAX;
+      size_t got, i;
+
+      got = intq_get (&q, buf, want);
+      if (got == 0 || got > want)
+        fail ("intq_get returned %zu of %zu", got, want);
+      for (i = 0; i < got; i++, pos++)
+        if (buf[i] != stream_byte (pos))
+          fail ("byte %zu is %d, expected %d",
+                pos, buf[i], stream_byte (pos));
+    }
+
+  sema_down (&done);
+  if (!intq_empty (&q))
+    fail ("bytes left over after the stream");
+  intq_destroy (&q);
+  msg ("received %d bytes in order", STREAM_SIZE);
+  pass ();
+}
+
+/* Puts the whole stream into Q in chunks. */
+static void
+producer (void *aux UNUSED) 
+{
+  uint8_t buf[CHUNK_MAX];
+  size_t pos = 0, puts = 0;
+
+  while (pos < STREAM_SIZE) 
+    {
+      size_t cnt = 1 + puts++ * 11 % CHUNK_MAX;
+      size_t i;
+
+      if (cnt > STREAM_SIZE - pos)
+        cnt = STREAM_SIZE - pos;
+      for (i = 0; i < cnt; i++)
+        buf[i] = stream_byte (pos + i);
+      if (intq_put (&q, buf, cnt) != cnt)
+        fail ("intq_put added fewer than %zu bytes", cnt);
+      pos += cnt;
+    }
+  sema_up (&done);
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(intq-bulk) begin
+(intq-bulk) received 20000 bytes in order
+(intq-bulk) PASS
+(intq-bulk) end
+EOF
+pass;
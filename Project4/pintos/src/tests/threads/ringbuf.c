@@ -0,0 +1,118 @@
+/* Checks the ring buffer in lib/kernel/ringbuf.c: FIFO order
+   through many wraparounds with bulk puts and gets of assorted
+   sizes, multi-byte elements, peek and discard, and a buffer
+   created with a capacity that is not a power of 2. */
+
+#include <ringbuf.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+
+/* A 3-byte element, so that copies do not line up with words. */
+struct elem
+  {
+    unsigned char b[3];
+  };
+
+/* Capacity of the fixed-size ring buffer, in elements. */
+#define CAPACITY 8
+
+static void set_elem (struct elem *, unsigned seq);
+static unsigned elem_seq (const struct elem *);
+
+void
+test_ringbuf (void) 
+{
+  static struct elem storage[CAPACITY];
+  struct elem in[CAPACITY + 3], out[CAPACITY + 3];
+  struct ringbuf rb, big;
+  unsigned next_in = 0, next_out = 0;
+  size_t i, round;
+  unsigned char c;
+
+  ringbuf_init (&rb, storage, sizeof *storage, CAPACITY);
+  if (!ringbuf_empty (&rb) || ringbuf_full (&rb)
+      || ringbuf_capacity (&rb) != CAPACITY
+      || ringbuf_space (&rb) != CAPACITY)
+    fail ("new ring buffer not empty");
+
+  /* Put and get runs of varying lengths, including runs longer
+     than the free space, so that the indexes wrap many times. */
+  for (round = 0; round < 1000; round++) 
+    {
+      size_t put_cnt = round % (CAPACITY + 3);
+      size_t get_cnt = (round * 7 + 3) % (CAPACITY + 3);
+      size_t space = ringbuf_space (&rb);
+      size_t count = ringbuf_count (&rb);
+      size_t put, got;
+
+      for (i = 0; i < put_cnt; i++)
+        set_elem (&in[i], next_in + i);
+      put = ringbuf_put (&rb, in, put_cnt);
+      if (put != (put_cnt < space ? put_cnt : space))
+        fail ("round %zu: put %zu of %zu with %zu free",
+              round, put, put_cnt, space);
+      next_in += put;
+      count += put;
+
+      if (ringbuf_count (&rb) != count
+          || ringbuf_full (&rb) != (count == CAPACITY))
+        fail ("round %zu: count %zu, expected %zu",
+              round, ringbuf_count (&rb), count);
+
+      got = ringbuf_get (&rb, out, get_cnt);
+      if (got != (get_cnt < count ? get_cnt : count))
+        fail ("round %zu: got %zu of %zu with %zu queued",
+              round, got, get_cnt, count);
+      for (i = 0; i < got; i++, next_out++)
+        if (elem_seq (&out[i]) != next_out)
+          fail ("round %zu: element %u out of order", round, next_out);
+    }
+
+  /* Peek leaves elements in place; discard drops them. */
+  ringbuf_discard (&rb, CAPACITY);
+  next_out = next_in;
+  for (i = 0; i < 5; i++)
+    set_elem (&in[i], next_in + i);
+  ringbuf_put (&rb, in, 5);
+  if (ringbuf_peek (&rb, out, 3) != 3 || elem_seq (&out[0]) != next_out
+      || ringbuf_count (&rb) != 5)
+    fail ("peek removed elements");
+  if (ringbuf_discard (&rb, 2) != 2
+      || ringbuf_get (&rb, out, CAPACITY) != 3
+      || elem_seq (&out[0]) != next_out + 2)
+    fail ("discard did not drop the oldest elements");
+  if (!ringbuf_empty (&rb))
+    fail ("ring buffer not empty after draining");
+
+  /* A created buffer rounds its capacity up to a power of 2. */
+  if (!ringbuf_create (&big, 1, 100))
+    fail ("ringbuf_create failed");
+  if (ringbuf_capacity (&big) != 128)
+    fail ("capacity %zu, expected 128", ringbuf_capacity (&big));
+  for (c = 0; ringbuf_put (&big, &c, 1) == 1; c++)
+    continue;
+  if (c != 128 || !ringbuf_full (&big))
+    fail ("created buffer held %d bytes", c);
+  for (i = 0; i < 128; i++)
+    if (ringbuf_get (&big, &c, 1) != 1 || c != i)
+      fail ("created buffer returned byte %d at %zu", c, i);
+  ringbuf_destroy (&big);
+
+  pass ();
+}
+
+/* Stores SEQ in E. */
+static void
+set_elem (struct elem *e, unsigned seq) 
+{
+  e->b[0] = seq;
+  e->b[1] = seq >> 8;
+  e->b[2] = seq >> 16;
+}
+
+/* Returns the sequence number stored in E. */
+static unsigned
+elem_seq (const struct elem *e) 
+{
+  return e->b[0] | (e->b[1] << 8) | (e->b[2] << 16);
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ringbuf) begin
+(ringbuf) PASS
+(ringbuf) end
+EOF
+pass;
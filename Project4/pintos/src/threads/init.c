@@ -20,6 +20,7 @@
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/profile.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
 #ifdef USERPROG
@@ -57,6 +58,17 @@ static const char *swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+/* Boot phases, for timing. */
+#define BOOT_PHASE_MAX 16
+struct boot_phase 
+  {
+    const char *name;           /* Name of phase. */
+    uint64_t cycles;            /* CPU cycles spent in the phase. */
+  };
+static struct boot_phase boot_phases[BOOT_PHASE_MAX];
+static size_t boot_phase_cnt;
+static uint64_t boot_phase_start;   /* Start of current phase. */
+
 static void bss_init (void);
 static void paging_init (void);
 
@@ -64,6 +76,8 @@ static char **read_command_line (void);
 static char **parse_options (char **argv);
 static void run_actions (char **argv);
 static void usage (void);
+static void boot_phase_done (const char *name);
+static void print_boot_phases (void);
 
 #ifdef FILESYS
 static void locate_block_devices (void);
@@ -80,10 +94,12 @@ main (void)
 
   /* Clear BSS. */  
   bss_init ();
+  boot_phase_start = timer_cycles ();
 
   /* Break command line into arguments and parse options. */
   argv = read_command_line ();
   argv = parse_options (argv);
+  boot_phase_done ("command line");
 
   /* Initialize ourselves as a thread so we can use locks,
      then enable console locking. */
@@ -93,11 +109,16 @@ main (void)
   /* Greet user. */
   printf ("Pintos booting with %'"PRIu32" kB RAM...\n",
           init_ram_pages * PGSIZE / 1024);
+  boot_phase_done ("thread/console");
 
   /* Initialize memory system. */
   palloc_init (user_page_limit);
+  boot_phase_done ("palloc_init");
   malloc_init ();
+  boot_phase_done ("malloc_init");
   paging_init ();
+  profile_init ();
+  boot_phase_done ("paging_init");
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -114,20 +135,26 @@ main (void)
   exception_init ();
   syscall_init ();
 #endif
+  boot_phase_done ("interrupts");
 
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
   serial_init_queue ();
+  boot_phase_done ("thread_start");
   timer_calibrate ();
+  boot_phase_done ("timer_calibrate");
 
 #ifdef FILESYS
-  /* Initialize file system. */
+  /* Initialize file system.  The disks are probed in the
+     background; locate_block_devices() waits for them. */
   ide_init ();
   locate_block_devices ();
   filesys_init (format_filesys);
+  boot_phase_done ("filesys_init");
 #endif
 
   printf ("Boot complete.\n");
+  print_boot_phases ();
   
   /* Run actions specified on kernel command line. */
   run_actions (argv);
@@ -137,6 +164,42 @@ main (void)
   thread_exit ();
 }
 
+/* Ends the current boot phase, charging the time spent in it to
+   NAME, and starts the next one. */
+static void
+boot_phase_done (const char *name) 
+{
+  uint64_t now = timer_cycles ();
+
+  if (boot_phase_cnt < BOOT_PHASE_MAX) 
+    {
+      struct boot_phase *p = &boot_phases[boot_phase_cnt++];
+      p->name = name;
+      p->cycles = now - boot_phase_start;
+    }
+  boot_phase_start = now;
+}
+
+/* Prints the time spent in each boot phase. */
+static void
+print_boot_phases (void) 
+{
+  uint64_t total = 0;
+  size_t i;
+
+  for (i = 0; i < boot_phase_cnt; i++)
+    total += boot_phases[i].cycles;
+  if (total == 0)
+    return;
+
+  printf ("Boot phases (%'"PRIu64" cycles, %'"PRId64" ticks):\n",
+          total, timer_ticks ());
+  for (i = 0; i < boot_phase_cnt; i++)
+    printf ("  %-16s %'15"PRIu64" cycles  %3d%%\n",
+            boot_phases[i].name, boot_phases[i].cycles,
+            (int) (boot_phases[i].cycles * 100 / total));
+}
+
 /* Clear the "BSS", a segment that should be initialized to
    zeros.  It isn't actually stored on disk or zeroed by the
    kernel loader, so we have to zero it ourselves.
@@ -256,6 +319,8 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-profile"))
+        profile_configure (true);
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -379,6 +444,7 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -profile           Sample the CPU on every timer tick.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -391,6 +457,10 @@ usage (void)
 static void
 locate_block_devices (void)
 {
+  /* Nothing can be located until every disk has been probed. */
+  ide_wait ();
+  boot_phase_done ("ide probe");
+
   locate_block_device (BLOCK_FILESYS, filesys_bdev_name);
   locate_block_device (BLOCK_SCRATCH, scratch_bdev_name);
 #ifdef VM
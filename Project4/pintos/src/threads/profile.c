@@ -0,0 +1,187 @@
+#include "threads/profile.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <ringbuf.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Number of pages of samples to preallocate.  The ring's
+   capacity is rounded down to a power of 2, so 64 pages of
+   60-byte samples hold 4096 samples, about 40 seconds of run
+   time at 100 Hz; later samples are counted but dropped. */
+#define PROFILE_PAGES 64
+
+/* Maximum number of return addresses recorded per sample. */
+#define PROFILE_DEPTH 12
+
+/* One sample. */
+struct profile_sample
+  {
+    uint32_t eip;               /* Interrupted instruction. */
+    tid_t tid;                  /* Interrupted thread. */
+    uint8_t user;               /* Interrupted in user mode? */
+    uint8_t depth;              /* Number of CALLERS. */
+    uint32_t callers[PROFILE_DEPTH]; /* Kernel return addresses. */
+  };
+
+/* Set by the "-profile" option. */
+static bool enabled;
+
+/* Samples, produced by the timer interrupt and consumed only by
+   profile_dump().  Valid only while SAMPLING is true. */
+static struct ringbuf samples;
+static bool sampling;
+
+/* Statistics. */
+static long long kernel_cnt;    /* # of samples in kernel mode. */
+static long long user_cnt;      /* # of samples in user mode. */
+static long long dropped_cnt;   /* # of samples that did not fit. */
+
+static int walk_stack (const struct intr_frame *, uint32_t *callers);
+
+/* Turns the profiler on or off.  Must be called before
+   profile_init() to have any effect. */
+void
+profile_configure (bool enable) 
+{
+  enabled = enable;
+}
+
+/* Allocates the sample buffer and starts sampling, if the
+   profiler was enabled.  Must be called after palloc_init(). */
+void
+profile_init (void) 
+{
+  size_t capacity;
+  void *buf;
+
+  if (!enabled)
+    return;
+
+  buf = palloc_get_multiple (0, PROFILE_PAGES);
+  if (buf == NULL) 
+    {
+      printf ("profile: could not allocate sample buffer\n");
+      return;
+    }
+
+  /* The ring buffer needs a power-of-2 capacity. */
+  for (capacity = 1;
+       capacity * 2 * sizeof (struct profile_sample)
+         <= PROFILE_PAGES * PGSIZE;
+       capacity *= 2)
+    continue;
+  ringbuf_init (&samples, buf, sizeof (struct profile_sample), capacity);
+
+#ifdef PROFILE_CALLERS
+  printf ("profile: sampling at %d Hz with call stacks, "
+          "room for %zu samples\n", TIMER_FREQ, capacity);
+#else
+  printf ("profile: sampling at %d Hz, room for %zu samples\n",
+          TIMER_FREQ, capacity);
+#endif
+  barrier ();
+  sampling = true;
+}
+
+/* Records a sample of the code interrupted by F.  Called by the
+   timer interrupt handler.  Code that runs with interrupts
+   turned off cannot be sampled, so its time is charged to
+   whatever runs next. */
+void
+profile_sample (const struct intr_frame *f) 
+{
+  struct profile_sample s;
+
+  if (!sampling)
+    return;
+
+  s.eip = (uint32_t) f->eip;
+  s.tid = thread_current ()->tid;
+  s.user = f->cs != SEL_KCSEG;
+  if (s.user) 
+    {
+      s.depth = 0;
+      user_cnt++;
+    }
+  else 
+    {
+      s.depth = walk_stack (f, s.callers);
+      kernel_cnt++;
+    }
+
+  if (ringbuf_put (&samples, &s, 1) == 0)
+    dropped_cnt++;
+}
+
+/* Stores in CALLERS the return addresses of the kernel frames
+   that F interrupted, innermost first, and returns how many
+   there are.  Only frames on the interrupted thread's own stack
+   page are followed, so a corrupt frame pointer cannot lead us
+   astray.  Without PROFILE_CALLERS, the kernel is built without
+   frame pointers, so there is no chain to follow and no callers
+   are recorded. */
+static int
+walk_stack (const struct intr_frame *f UNUSED, uint32_t *callers UNUSED) 
+{
+#ifdef PROFILE_CALLERS
+  void *stack = pg_round_down (f);
+  void **frame = (void **) f->ebp;
+  int depth = 0;
+
+  while (depth < PROFILE_DEPTH
+         && pg_round_down (frame) == stack
+         && (void *) (frame + 2) <= stack + PGSIZE
+         && frame[1] != NULL) 
+    {
+      void **next = frame[0];
+      callers[depth++] = (uint32_t) frame[1];
+      if (next <= frame)
+        break;
+      frame = next;
+    }
+  return depth;
+#else
+  return 0;
+#endif
+}
+
+/* Stops sampling and prints every recorded sample, one per
+   line, in the form
+   "Profile sample: TID MODE EIP CALLER...." where MODE is `k'
+   for kernel or `u' for user. */
+void
+profile_dump (void) 
+{
+  struct profile_sample s;
+  enum intr_level old_level;
+
+  if (!sampling)
+    return;
+
+  old_level = intr_disable ();
+  sampling = false;
+  intr_set_level (old_level);
+
+  printf ("Profile: %lld samples (%lld kernel, %lld user), "
+          "%lld dropped\n",
+          kernel_cnt + user_cnt, kernel_cnt, user_cnt, dropped_cnt);
+  while (ringbuf_get (&samples, &s, 1) == 1) 
+    {
+      int i;
+
+      printf ("Profile sample: %d %c %#"PRIx32,
+              s.tid, s.user ? 'u' : 'k', s.eip);
+      for (i = 0; i < s.depth; i++)
+        printf (" %#"PRIx32, s.callers[i]);
+      printf (".\n");
+    }
+  printf ("Run `backtrace --profile=FILE' on this output "
+          "to get a profile.\n");
+}
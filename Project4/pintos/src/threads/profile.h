@@ -0,0 +1,32 @@
+#ifndef THREADS_PROFILE_H
+#define THREADS_PROFILE_H
+
+#include <stdbool.h>
+
+struct intr_frame;
+
+/* Sampling profiler.
+
+   When enabled with the "-profile" kernel command-line option,
+   every timer interrupt records the interrupted instruction, the
+   running thread, and whether it was running in user or kernel
+   mode.  The samples are printed at shutdown for `backtrace
+   --profile' to turn into a flat profile.
+
+   If the kernel is built with PROFILE_CALLERS defined, kernel-mode
+   samples also record the call stack, found by following the
+   frame-pointer chain, and `backtrace --profile' adds a call
+   graph.  The call stack is only trustworthy because defining
+   PROFILE_CALLERS also builds the kernel with
+   -fno-omit-frame-pointer (see Make.config); -O alone omits frame
+   pointers from most functions.  Even so, a sample taken in a
+   function's prologue, before it has set up its frame, or in
+   assembly code, which sets up none, misses the function's
+   immediate caller. */
+
+void profile_configure (bool enable);
+void profile_init (void);
+void profile_sample (const struct intr_frame *);
+void profile_dump (void);
+
+#endif /* threads/profile.h */
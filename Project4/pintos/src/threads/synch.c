@@ -27,10 +27,42 @@
 */
 
 #include "threads/synch.h"
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#ifdef LOCK_STATS
+#include "devices/timer.h"
+
+/* Contention statistics for locks.
+
+   Locks are grouped by name, which by default is the expression
+   passed to lock_init(), so that, e.g., the locks of all the
+   buffer cache entries are counted together.  The statistics
+   outlive the locks, so locks that are created and destroyed
+   over and over still show up. */
+struct lock_stats 
+  {
+    const char *name;                   /* Name shared by the locks. */
+    unsigned init_cnt;                  /* lock_init() calls with this name. */
+    unsigned long long acquire_cnt;     /* Number of acquisitions. */
+    unsigned long long contend_cnt;     /* Acquisitions that had to wait. */
+    uint64_t wait_cycles;               /* Total time spent waiting. */
+    uint64_t max_wait_cycles;           /* Longest wait. */
+    uint64_t hold_cycles;               /* Total time held. */
+    uint64_t max_hold_cycles;           /* Longest hold. */
+  };
+
+#define LOCK_STATS_CNT 64               /* Maximum number of names. */
+#define LOCK_STATS_TOP 10               /* Number of names reported. */
+static struct lock_stats lock_stats[LOCK_STATS_CNT];
+
+static struct lock_stats *lock_stats_find (const char *name);
+static void lock_stats_acquired (struct lock *, uint64_t start,
+                                 bool contended);
+static void lock_stats_released (struct lock *);
+#endif
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -173,12 +205,15 @@ sema_test_helper (void *sema_)
    onerous, it's a good sign that a semaphore should be used,
    instead of a lock. */
 void
-lock_init (struct lock *lock)
+lock_init_named (struct lock *lock, const char *name UNUSED)
 {
   ASSERT (lock != NULL);
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+#ifdef LOCK_STATS
+  lock->stats = lock_stats_find (name);
+#endif
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -192,12 +227,25 @@ lock_init (struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
+#ifdef LOCK_STATS
+  uint64_t start;
+  bool contended;
+#endif
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
+#ifdef LOCK_STATS
+  start = timer_cycles ();
+  contended = lock->holder != NULL;
+#endif
+
   sema_down (&lock->semaphore);
   lock->holder = thread_current ();
+#ifdef LOCK_STATS
+  lock_stats_acquired (lock, start, contended);
+#endif
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -215,8 +263,13 @@ lock_try_acquire (struct lock *lock)
   ASSERT (!lock_held_by_current_thread (lock));
 
   success = sema_try_down (&lock->semaphore);
-  if (success)
-    lock->holder = thread_current ();
+  if (success) 
+    {
+      lock->holder = thread_current ();
+#ifdef LOCK_STATS
+      lock_stats_acquired (lock, timer_cycles (), false);
+#endif
+    }
   return success;
 }
 
@@ -231,6 +284,9 @@ lock_release (struct lock *lock)
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+#ifdef LOCK_STATS
+  lock_stats_released (lock);
+#endif
   lock->holder = NULL;
   sema_up (&lock->semaphore);
 }
@@ -336,3 +392,110 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+#ifdef LOCK_STATS
+/* Returns the statistics for locks named NAME, creating them if
+   necessary, or a null pointer if there is no room for another
+   name. */
+static struct lock_stats *
+lock_stats_find (const char *name) 
+{
+  struct lock_stats *s, *found = NULL;
+  enum intr_level old_level;
+
+  if (name[0] == '&')
+    name++;
+
+  old_level = intr_disable ();
+  for (s = lock_stats; s < lock_stats + LOCK_STATS_CNT; s++)
+    if (s->name == NULL || !strcmp (s->name, name)) 
+      {
+        s->name = name;
+        s->init_cnt++;
+        found = s;
+        break;
+      }
+  intr_set_level (old_level);
+  return found;
+}
+
+/* Records that the current thread has just acquired LOCK after
+   trying since START, and whether it had to wait. */
+static void
+lock_stats_acquired (struct lock *lock, uint64_t start, bool contended) 
+{
+  struct lock_stats *s = lock->stats;
+  uint64_t now = timer_cycles ();
+  enum intr_level old_level;
+
+  lock->acquired = now;
+  if (s == NULL)
+    return;
+
+  old_level = intr_disable ();
+  s->acquire_cnt++;
+  if (contended) 
+    {
+      uint64_t wait = now - start;
+      s->contend_cnt++;
+      s->wait_cycles += wait;
+      if (wait > s->max_wait_cycles)
+        s->max_wait_cycles = wait;
+    }
+  intr_set_level (old_level);
+}
+
+/* Records that the current thread is about to release LOCK. */
+static void
+lock_stats_released (struct lock *lock) 
+{
+  struct lock_stats *s = lock->stats;
+  uint64_t hold;
+  enum intr_level old_level;
+
+  if (s == NULL)
+    return;
+
+  hold = timer_cycles () - lock->acquired;
+  old_level = intr_disable ();
+  s->hold_cycles += hold;
+  if (hold > s->max_hold_cycles)
+    s->max_hold_cycles = hold;
+  intr_set_level (old_level);
+}
+
+/* Prints the statistics of the LOCK_STATS_TOP lock names with
+   the most total time spent waiting for them. */
+void
+lock_print_stats (void) 
+{
+  bool printed[LOCK_STATS_CNT];
+  int i, j;
+
+  printf ("Locks: top %d by wait time, in cycles:\n", LOCK_STATS_TOP);
+  for (i = 0; i < LOCK_STATS_CNT; i++)
+    printed[i] = false;
+  for (i = 0; i < LOCK_STATS_TOP; i++) 
+    {
+      struct lock_stats *s;
+      int best = -1;
+
+      for (j = 0; j < LOCK_STATS_CNT; j++)
+        if (lock_stats[j].name != NULL && !printed[j]
+            && (best < 0
+                || lock_stats[j].wait_cycles > lock_stats[best].wait_cycles))
+          best = j;
+      if (best < 0 || lock_stats[best].acquire_cnt == 0)
+        break;
+      printed[best] = true;
+
+      s = &lock_stats[best];
+      printf ("  %s (%u): %llu acquires, %llu contended, "
+              "wait %"PRIu64" (max %"PRIu64"), "
+              "hold %"PRIu64" (max %"PRIu64")\n",
+              s->name, s->init_cnt, s->acquire_cnt, s->contend_cnt,
+              s->wait_cycles, s->max_wait_cycles,
+              s->hold_cycles, s->max_hold_cycles);
+    }
+}
+#endif /* LOCK_STATS */
@@ -3,6 +3,7 @@
 
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /* A counting semaphore. */
 struct semaphore 
@@ -17,19 +18,39 @@ bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
 
+#ifdef LOCK_STATS
+struct lock_stats;
+#endif
+
 /* Lock. */
 struct lock 
   {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+#ifdef LOCK_STATS
+    struct lock_stats *stats;   /* Contention statistics, or null. */
+    uint64_t acquired;          /* When the holder got the lock. */
+#endif
   };
 
-void lock_init (struct lock *);
+void lock_init_named (struct lock *, const char *name);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
+/* Initializes LOCK, naming it for lock statistics after the
+   expression used to refer to it, e.g. "&filesys_lock". */
+#define lock_init(LOCK) lock_init_named (LOCK, #LOCK)
+
+/* Lock contention statistics, kept if the kernel is built with
+   -DLOCK_STATS and otherwise compiled out entirely. */
+#ifdef LOCK_STATS
+void lock_print_stats (void);
+#else
+static inline void lock_print_stats (void) { }
+#endif
+
 /* Condition variable. */
 struct condition 
   {
@@ -116,6 +116,10 @@ syscall_handler (struct intr_frame *f UNUSED)
     check_address((void*)arg[0]);
     close((int)*arg[0]);
     break;
+
+    case SYS_STATS :
+    stats();
+    break;
   }
 }
 
@@ -172,6 +176,13 @@ exit (int status)
   thread_exit();
 }
 
+/* Print kernel statistics, as at shutdown */
+void
+stats (void)
+{
+  shutdown_print_stats();
+}
+
 /* Create file */
 bool
 create (const char *file, unsigned initial_size)
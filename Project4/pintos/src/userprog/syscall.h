@@ -29,7 +29,8 @@ int write (int fd, void *buffer, unsigned size);
 void seek (int fd, unsigned position);
 unsigned tell (int fd);
 void close (int fd);
-
+/* For kernel statistics */
+void stats (void);
 
 /* Added varialbes */
 /* For file descriptor */